@@ -116,6 +116,31 @@ UnlinkedFunctionExecutable::UnlinkedFunctionExecutable(VM* vm, Structure* struct
     ASSERT(m_constructorKind == static_cast<unsigned>(node->constructorKind()));
 }
 
+// For CodeCacheStorage, which fills in the rest from its file
+UnlinkedFunctionExecutable::UnlinkedFunctionExecutable(VM* vm, Structure* structure, const Identifier& name, const Identifier& inferredName, PassRefPtr<FunctionParameters> parameters)
+    : Base(*vm, structure)
+    , m_name(name)
+    , m_inferredName(inferredName)
+    , m_parameters(parameters)
+    , m_firstLineOffset(0)
+    , m_lineCount(0)
+    , m_unlinkedFunctionNameStart(0)
+    , m_unlinkedBodyStartColumn(0)
+    , m_unlinkedBodyEndColumn(0)
+    , m_startOffset(0)
+    , m_sourceLength(0)
+    , m_parametersStartOffset(0)
+    , m_typeProfilingStartOffset(0)
+    , m_typeProfilingEndOffset(0)
+    , m_features(0)
+    , m_isInStrictContext(false)
+    , m_hasCapturedVariables(false)
+    , m_isBuiltinFunction(false)
+    , m_constructorKind(static_cast<unsigned>(ConstructorKind::None))
+    , m_functionMode(FunctionDeclaration)
+{
+}
+
 size_t UnlinkedFunctionExecutable::parameterCount() const
 {
     return m_parameters->size();
@@ -75,6 +75,13 @@ static void append32(unsigned char*& ptr, unsigned value)
     *(ptr++) = (value >> 24) & 0xff;
 }
 
+UnlinkedInstructionStream::UnlinkedInstructionStream(const unsigned char* data, unsigned length, unsigned instructionCount)
+    : m_data(length)
+    , m_instructionCount(instructionCount)
+{
+    memcpy(m_data.data(), data, length);
+}
+
 UnlinkedInstructionStream::UnlinkedInstructionStream(const Vector<UnlinkedInstruction, 0, UnsafeVectorOverflow>& instructions)
     : m_instructionCount(instructions.size())
 {
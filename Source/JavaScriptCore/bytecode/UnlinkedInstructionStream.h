@@ -61,6 +61,9 @@ public:
 
 private:
     friend class Reader;
+    friend class CodeCacheStorage;
+
+    UnlinkedInstructionStream(const unsigned char* data, unsigned length, unsigned instructionCount);
 
 #ifndef NDEBUG
     mutable RefCountedArray<UnlinkedInstruction> m_unpackedInstructionsForDebugging;
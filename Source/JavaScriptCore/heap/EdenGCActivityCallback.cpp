@@ -30,7 +30,7 @@
 
 namespace JSC {
 
-#if USE(CF) || PLATFORM(EFL)
+#if USE(CF) || PLATFORM(EFL) || PLATFORM(FLTK)
 
 EdenGCActivityCallback::EdenGCActivityCallback(Heap* heap)
     : GCActivityCallback(heap)
@@ -88,6 +88,6 @@ double EdenGCActivityCallback::gcTimeSlice(size_t)
     return 0;
 }
 
-#endif // USE(CF) || PLATFORM(EFL)
+#endif // USE(CF) || PLATFORM(EFL) || PLATFORM(FLTK)
 
 } // namespace JSC
@@ -37,7 +37,7 @@
 #include <wtf/RetainPtr.h>
 #include <wtf/WTFThreadData.h>
 
-#if PLATFORM(EFL)
+#if PLATFORM(EFL) || PLATFORM(FLTK)
 #include <wtf/MainThread.h>
 #endif
 
@@ -45,7 +45,7 @@ namespace JSC {
 
 bool GCActivityCallback::s_shouldCreateGCTimer = true;
 
-#if USE(CF) || PLATFORM(EFL)
+#if USE(CF) || PLATFORM(EFL) || PLATFORM(FLTK)
 
 const double timerSlop = 2.0; // Fudge factor to avoid performance cost of resetting timer.
 
@@ -59,7 +59,7 @@ GCActivityCallback::GCActivityCallback(Heap* heap, CFRunLoopRef runLoop)
     : GCActivityCallback(heap->vm(), runLoop)
 {
 }
-#elif PLATFORM(EFL)
+#elif PLATFORM(EFL) || PLATFORM(FLTK)
 GCActivityCallback::GCActivityCallback(Heap* heap)
     : GCActivityCallback(heap->vm(), WTF::isMainThread())
 {
@@ -109,6 +109,21 @@ void GCActivityCallback::scheduleTimer(double newDelay)
     m_timer = add(newDelay, this);
 }
 
+void GCActivityCallback::cancelTimer()
+{
+    m_delay = s_hour;
+    stop();
+}
+#elif PLATFORM(FLTK)
+void GCActivityCallback::scheduleTimer(double newDelay)
+{
+    if (newDelay * timerSlop > m_delay)
+        return;
+
+    m_delay = newDelay;
+    add(newDelay);
+}
+
 void GCActivityCallback::cancelTimer()
 {
     m_delay = s_hour;
@@ -118,7 +133,7 @@ void GCActivityCallback::cancelTimer()
 
 void GCActivityCallback::didAllocate(size_t bytes)
 {
-#if PLATFORM(EFL)
+#if PLATFORM(EFL) || PLATFORM(FLTK)
     if (!isEnabled())
         return;
 
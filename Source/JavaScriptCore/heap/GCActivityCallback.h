@@ -72,7 +72,7 @@ protected:
         , m_delay(s_decade)
     {
     }
-#elif PLATFORM(EFL)
+#elif PLATFORM(EFL) || PLATFORM(FLTK)
     static constexpr double s_hour = 3600;
     GCActivityCallback(VM* vm, bool flag)
         : HeapTimer(vm)
@@ -94,7 +94,7 @@ protected:
 protected:
     GCActivityCallback(Heap*, CFRunLoopRef);
 #endif
-#if USE(CF) || PLATFORM(EFL)
+#if USE(CF) || PLATFORM(EFL) || PLATFORM(FLTK)
 protected:
     void cancelTimer();
     void scheduleTimer(double);
@@ -354,6 +354,8 @@ Heap::Heap(VM* vm, HeapType heapType)
 #endif
 #if USE(CF)
     , m_sweeper(std::make_unique<IncrementalSweeper>(this, CFRunLoopGetCurrent()))
+#elif PLATFORM(FLTK)
+    , m_sweeper(std::make_unique<IncrementalSweeper>(this))
 #else
     , m_sweeper(std::make_unique<IncrementalSweeper>(this->vm()))
 #endif
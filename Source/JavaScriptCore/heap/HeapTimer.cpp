@@ -36,6 +36,8 @@
 
 #if PLATFORM(EFL)
 #include <Ecore.h>
+#elif PLATFORM(FLTK)
+#include <FL/Fl.H>
 #endif
 
 namespace JSC {
@@ -140,6 +142,50 @@ bool HeapTimer::timerEvent(void* info)
     
     return ECORE_CALLBACK_CANCEL;
 }
+
+#elif PLATFORM(FLTK)
+
+HeapTimer::HeapTimer(VM* vm)
+    : m_vm(vm)
+    , m_scheduled(false)
+{
+}
+
+HeapTimer::~HeapTimer()
+{
+    stop();
+}
+
+// FLTK timers only fire on the main thread. VMs on other threads keep
+// collecting on allocation alone.
+void HeapTimer::add(double delay)
+{
+    if (!isMainThread())
+        return;
+
+    stop();
+    Fl::add_timeout(delay, timerEvent, this);
+    m_scheduled = true;
+}
+
+void HeapTimer::stop()
+{
+    if (!m_scheduled)
+        return;
+
+    Fl::remove_timeout(timerEvent, this);
+    m_scheduled = false;
+}
+
+void HeapTimer::timerEvent(void* info)
+{
+    HeapTimer* agent = static_cast<HeapTimer*>(info);
+    agent->m_scheduled = false;
+
+    JSLockHolder locker(agent->m_vm);
+    agent->doWork();
+}
+
 #else
 HeapTimer::HeapTimer(VM* vm)
     : m_vm(vm)
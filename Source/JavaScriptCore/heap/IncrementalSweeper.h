@@ -40,6 +40,9 @@ public:
 #if USE(CF)
     JS_EXPORT_PRIVATE IncrementalSweeper(Heap*, CFRunLoopRef);
     JS_EXPORT_PRIVATE void fullSweep();
+#elif PLATFORM(FLTK)
+    explicit IncrementalSweeper(Heap*);
+    void fullSweep();
 #else
     explicit IncrementalSweeper(VM*);
 #endif
@@ -51,7 +54,7 @@ public:
     bool sweepNextBlock();
     void willFinishSweeping();
 
-#if USE(CF)
+#if USE(CF) || PLATFORM(FLTK)
 private:
     void doSweep(double startTime);
     void scheduleTimer();
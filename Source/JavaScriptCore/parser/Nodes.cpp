@@ -161,6 +161,22 @@ FunctionParameters::FunctionParameters(ParameterNode* firstParameter, unsigned s
     }
 }
 
+PassRefPtr<FunctionParameters> FunctionParameters::create(const Vector<RefPtr<DeconstructionPatternNode>>& patterns)
+{
+    size_t objectSize = sizeof(FunctionParameters) - sizeof(void*) + sizeof(DeconstructionPatternNode*) * patterns.size();
+    void* slot = fastMalloc(objectSize);
+    return adoptRef(new (slot) FunctionParameters(patterns));
+}
+
+FunctionParameters::FunctionParameters(const Vector<RefPtr<DeconstructionPatternNode>>& patterns)
+    : m_size(patterns.size())
+{
+    for (unsigned i = 0; i < m_size; ++i) {
+        patterns[i]->ref();
+        this->patterns()[i] = patterns[i].get();
+    }
+}
+
 FunctionParameters::~FunctionParameters()
 {
     for (unsigned i = 0; i < m_size; ++i)
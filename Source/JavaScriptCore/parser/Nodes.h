@@ -1619,6 +1619,7 @@ namespace JSC {
         WTF_MAKE_NONCOPYABLE(FunctionParameters);
     public:
         static PassRefPtr<FunctionParameters> create(ParameterNode*);
+        static PassRefPtr<FunctionParameters> create(const Vector<RefPtr<DeconstructionPatternNode>>&);
         ~FunctionParameters();
 
         unsigned size() const { return m_size; }
@@ -1626,6 +1627,7 @@ namespace JSC {
 
     private:
         FunctionParameters(ParameterNode*, unsigned size);
+        FunctionParameters(const Vector<RefPtr<DeconstructionPatternNode>>&);
 
         DeconstructionPatternNode** patterns() { return &m_storage; }
 
@@ -28,6 +28,7 @@
 #include "CodeCache.h"
 
 #include "BytecodeGenerator.h"
+#include "CodeCacheStorage.h"
 #include "CodeSpecializationKind.h"
 #include "JSCInlines.h"
 #include "Parser.h"
@@ -74,6 +75,30 @@ template <> struct CacheTypes<UnlinkedEvalCodeBlock> {
     static const SourceCodeKey::CodeType codeType = SourceCodeKey::EvalType;
 };
 
+// Only program code goes to disk. Eval code is small, and tied to the
+// scope it runs in.
+static UnlinkedProgramCodeBlock* loadFromStorage(VM& vm, ProgramExecutable*, const SourceCode& source, JSParserBuiltinMode builtinMode, JSParserStrictMode strictMode)
+{
+    if (builtinMode == JSParserBuiltinMode::Builtin)
+        return nullptr;
+    return CodeCacheStorage::load(vm, source, strictMode);
+}
+
+static UnlinkedEvalCodeBlock* loadFromStorage(VM&, EvalExecutable*, const SourceCode&, JSParserBuiltinMode, JSParserStrictMode)
+{
+    return nullptr;
+}
+
+static void saveToStorage(UnlinkedProgramCodeBlock* unlinkedCodeBlock, const SourceCode& source, JSParserBuiltinMode builtinMode, JSParserStrictMode strictMode)
+{
+    if (builtinMode == JSParserBuiltinMode::NotBuiltin)
+        CodeCacheStorage::store(source, strictMode, unlinkedCodeBlock);
+}
+
+static void saveToStorage(UnlinkedEvalCodeBlock*, const SourceCode&, JSParserBuiltinMode, JSParserStrictMode)
+{
+}
+
 template <class UnlinkedCodeBlockType, class ExecutableType>
 UnlinkedCodeBlockType* CodeCache::getGlobalCodeBlock(VM& vm, ExecutableType* executable, const SourceCode& source, JSParserBuiltinMode builtinMode,
     JSParserStrictMode strictMode, ThisTDZMode thisTDZMode, DebuggerMode debuggerMode, ProfilerMode profilerMode, ParserError& error)
@@ -81,8 +106,15 @@ UnlinkedCodeBlockType* CodeCache::getGlobalCodeBlock(VM& vm, ExecutableType* exe
     SourceCodeKey key = SourceCodeKey(source, String(), CacheTypes<UnlinkedCodeBlockType>::codeType, builtinMode, strictMode, thisTDZMode);
     SourceCodeValue* cache = m_sourceCode.findCacheAndUpdateAge(key);
     bool canCache = debuggerMode == DebuggerOff && profilerMode == ProfilerOff && !vm.typeProfiler() && !vm.controlFlowProfiler();
-    if (cache && canCache) {
-        UnlinkedCodeBlockType* unlinkedCodeBlock = jsCast<UnlinkedCodeBlockType*>(cache->cell.get());
+    UnlinkedCodeBlockType* unlinkedCodeBlock = nullptr;
+    if (cache && canCache)
+        unlinkedCodeBlock = jsCast<UnlinkedCodeBlockType*>(cache->cell.get());
+    else if (!cache && canCache) {
+        unlinkedCodeBlock = loadFromStorage(vm, executable, source, builtinMode, strictMode);
+        if (unlinkedCodeBlock)
+            m_sourceCode.addCache(key, SourceCodeValue(vm, unlinkedCodeBlock, m_sourceCode.age()));
+    }
+    if (unlinkedCodeBlock) {
         unsigned firstLine = source.firstLine() + unlinkedCodeBlock->firstLine();
         unsigned lineCount = unlinkedCodeBlock->lineCount();
         unsigned startColumn = unlinkedCodeBlock->startColumn() + source.startColumn();
@@ -106,7 +138,7 @@ UnlinkedCodeBlockType* CodeCache::getGlobalCodeBlock(VM& vm, ExecutableType* exe
     unsigned endColumn = unlinkedEndColumn + (endColumnIsOnStartLine ? startColumn : 1);
     executable->recordParse(rootNode->features(), rootNode->hasCapturedVariables(), rootNode->firstLine(), rootNode->lastLine(), startColumn, endColumn);
 
-    UnlinkedCodeBlockType* unlinkedCodeBlock = UnlinkedCodeBlockType::create(&vm, executable->executableInfo());
+    unlinkedCodeBlock = UnlinkedCodeBlockType::create(&vm, executable->executableInfo());
     unlinkedCodeBlock->recordParse(rootNode->features(), rootNode->hasCapturedVariables(), rootNode->firstLine() - source.firstLine(), lineCount, unlinkedEndColumn);
 
     auto generator = std::make_unique<BytecodeGenerator>(vm, rootNode.get(), unlinkedCodeBlock, debuggerMode, profilerMode);
@@ -118,6 +150,7 @@ UnlinkedCodeBlockType* CodeCache::getGlobalCodeBlock(VM& vm, ExecutableType* exe
         return unlinkedCodeBlock;
 
     m_sourceCode.addCache(key, SourceCodeValue(vm, unlinkedCodeBlock, m_sourceCode.age()));
+    saveToStorage(unlinkedCodeBlock, source, builtinMode, strictMode);
     return unlinkedCodeBlock;
 }
 
@@ -0,0 +1,1015 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include "CodeCacheStorage.h"
+
+#include "JSCInlines.h"
+#include "NodeConstructors.h"
+#include "Options.h"
+#include "SourceCode.h"
+#include "SymbolTable.h"
+#include "UnlinkedCodeBlock.h"
+#include "UnlinkedInstructionStream.h"
+#include <type_traits>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/SHA1.h>
+#include <wtf/SpinLock.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringBuilder.h>
+
+#if OS(UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace JSC {
+
+// Bump when the layout below changes. The opcodes go into the file names
+// too, so a JSC with different bytecode never finds these files.
+static const char formatVersion[] = "2";
+
+#define OPCODE_STAMP(opcode, length) #opcode #length
+static const char opcodeStamp[] = FOR_EACH_OPCODE_ID(OPCODE_STAMP);
+#undef OPCODE_STAMP
+
+static const char magic[4] = { 'J', 'S', 'C', 'B' };
+
+// Small scripts compile about as fast as they load
+static const unsigned minimumSourceLength = 1024;
+
+static const uint32_t nullStringLength = UINT_MAX;
+
+enum IdentifierTag : uint8_t {
+    NullIdentifier,
+    PlainIdentifier,
+    PrivateIdentifier,
+    WellKnownSymbolIdentifier
+};
+
+enum ConstantTag : uint8_t {
+    EmptyConstant,
+    UndefinedConstant,
+    NullConstant,
+    FalseConstant,
+    TrueConstant,
+    Int32Constant,
+    DoubleConstant,
+    StringConstant,
+    NameScopeConstant,
+    ConstantRegisterReference
+};
+
+static Vector<const Identifier*> wellKnownSymbols(VM& vm)
+{
+    Vector<const Identifier*> symbols;
+#define APPEND_WELL_KNOWN_SYMBOL(name) symbols.append(&vm.propertyNames->name##Symbol);
+    JSC_COMMON_PRIVATE_IDENTIFIERS_EACH_WELL_KNOWN_SYMBOL(APPEND_WELL_KNOWN_SYMBOL)
+#undef APPEND_WELL_KNOWN_SYMBOL
+    return symbols;
+}
+
+class CodeCacheStorage::Encoder {
+public:
+    explicit Encoder(VM& vm)
+        : m_vm(vm)
+        , m_failed(false)
+    {
+    }
+
+    VM& vm() const { return m_vm; }
+    const Vector<uint8_t>& buffer() const { return m_buffer; }
+    size_t size() const { return m_buffer.size(); }
+
+    // Something the format can't express, the script won't be stored
+    void fail() { m_failed = true; }
+    bool failed() const { return m_failed; }
+
+    void encodeBytes(const void* data, size_t length)
+    {
+        m_buffer.append(static_cast<const uint8_t*>(data), length);
+    }
+
+    template<typename T> void encode(const T& value)
+    {
+        static_assert(std::is_pod<T>::value, "Only plain data is copied as is");
+        encodeBytes(&value, sizeof(T));
+    }
+
+    // Fills in a value encoded earlier as a placeholder
+    template<typename T> void encodeAt(size_t offset, const T& value)
+    {
+        static_assert(std::is_pod<T>::value, "Only plain data is copied as is");
+        memcpy(m_buffer.data() + offset, &value, sizeof(T));
+    }
+
+    template<typename T, size_t inlineCapacity, typename OverflowHandler> void encode(const Vector<T, inlineCapacity, OverflowHandler>& vector)
+    {
+        static_assert(std::is_pod<T>::value, "Only plain data is copied as is");
+        encode<uint32_t>(vector.size());
+        encodeBytes(vector.data(), vector.size() * sizeof(T));
+    }
+
+    void encode(const String& string)
+    {
+        if (string.isNull()) {
+            encode(nullStringLength);
+            return;
+        }
+
+        encode<uint32_t>(string.length());
+        encode<uint8_t>(string.is8Bit());
+        if (string.is8Bit())
+            encodeBytes(string.characters8(), string.length());
+        else
+            encodeBytes(string.characters16(), string.length() * sizeof(UChar));
+    }
+
+    void encode(const Identifier& identifier)
+    {
+        if (identifier.isNull()) {
+            encode(NullIdentifier);
+            return;
+        }
+
+        if (!identifier.impl()->isSymbol()) {
+            encode(PlainIdentifier);
+            encode(identifier.string());
+            return;
+        }
+
+        // Symbols are stored by the name they have in the VM
+        if (m_vm.propertyNames->isPrivateName(identifier)) {
+            encode(PrivateIdentifier);
+            encode(m_vm.propertyNames->getPublicName(identifier).string());
+            return;
+        }
+
+        Vector<const Identifier*> symbols = wellKnownSymbols(m_vm);
+        for (unsigned i = 0; i < symbols.size(); ++i) {
+            if (*symbols[i] == identifier) {
+                encode(WellKnownSymbolIdentifier);
+                encode<uint32_t>(i);
+                return;
+            }
+        }
+
+        fail();
+    }
+
+    void encode(const JSTextPosition& position)
+    {
+        encode<int32_t>(position.line);
+        encode<int32_t>(position.offset);
+        encode<int32_t>(position.lineStartOffset);
+    }
+
+private:
+    VM& m_vm;
+    Vector<uint8_t> m_buffer;
+    bool m_failed;
+};
+
+class CodeCacheStorage::Decoder {
+public:
+    Decoder(VM& vm, const uint8_t* data, size_t length)
+        : m_vm(vm)
+        , m_data(data)
+        , m_end(data + length)
+        , m_failed(false)
+    {
+    }
+
+    VM& vm() const { return m_vm; }
+
+    // A damaged or foreign file, everything after this reads as zero
+    void fail()
+    {
+        m_failed = true;
+        m_data = m_end;
+    }
+    bool failed() const { return m_failed; }
+    bool atEnd() const { return m_data == m_end; }
+    const uint8_t* position() const { return m_data; }
+    size_t remaining() const { return m_end - m_data; }
+
+    const uint8_t* decodeBytes(size_t length)
+    {
+        if (static_cast<size_t>(m_end - m_data) < length) {
+            fail();
+            return nullptr;
+        }
+
+        const uint8_t* bytes = m_data;
+        m_data += length;
+        return bytes;
+    }
+
+    template<typename T> T decode()
+    {
+        static_assert(std::is_pod<T>::value, "Only plain data is copied as is");
+        T value;
+        memset(&value, 0, sizeof(T));
+        if (const uint8_t* bytes = decodeBytes(sizeof(T)))
+            memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    // A count of things at least |size| bytes each. Checked against what's
+    // left, so a bad file can't make us allocate much.
+    unsigned decodeCount(size_t size = 1)
+    {
+        uint32_t count = decode<uint32_t>();
+        if (count > static_cast<size_t>(m_end - m_data) / size) {
+            fail();
+            return 0;
+        }
+        return count;
+    }
+
+    template<typename T, size_t inlineCapacity, typename OverflowHandler> void decode(Vector<T, inlineCapacity, OverflowHandler>& vector)
+    {
+        static_assert(std::is_pod<T>::value, "Only plain data is copied as is");
+        unsigned count = decodeCount(sizeof(T));
+        const uint8_t* bytes = decodeBytes(count * sizeof(T));
+        if (!bytes)
+            return;
+        vector.resize(count);
+        memcpy(vector.data(), bytes, count * sizeof(T));
+    }
+
+    String decodeString()
+    {
+        uint32_t length = decode<uint32_t>();
+        if (length == nullStringLength || failed())
+            return String();
+
+        bool is8Bit = decode<uint8_t>();
+        size_t characterSize = is8Bit ? sizeof(LChar) : sizeof(UChar);
+        if (length > static_cast<size_t>(m_end - m_data) / characterSize) {
+            fail();
+            return String();
+        }
+
+        const uint8_t* bytes = decodeBytes(length * characterSize);
+        if (is8Bit)
+            return String(reinterpret_cast<const LChar*>(bytes), length);
+
+        UChar* characters;
+        String string = String::createUninitialized(length, characters);
+        memcpy(characters, bytes, length * sizeof(UChar));
+        return string;
+    }
+
+    Identifier decodeIdentifier()
+    {
+        switch (decode<IdentifierTag>()) {
+        case NullIdentifier:
+            if (failed())
+                break;
+            return Identifier();
+        case PlainIdentifier: {
+            String string = decodeString();
+            if (string.isNull())
+                break;
+            return Identifier::fromString(&m_vm, string);
+        }
+        case PrivateIdentifier: {
+            String string = decodeString();
+            if (string.isNull())
+                break;
+            if (const Identifier* privateName = m_vm.propertyNames->getPrivateName(Identifier::fromString(&m_vm, string)))
+                return *privateName;
+            break;
+        }
+        case WellKnownSymbolIdentifier: {
+            unsigned index = decode<uint32_t>();
+            Vector<const Identifier*> symbols = wellKnownSymbols(m_vm);
+            if (index < symbols.size())
+                return *symbols[index];
+            break;
+        }
+        }
+
+        fail();
+        return Identifier();
+    }
+
+    JSTextPosition decodePosition()
+    {
+        int line = decode<int32_t>();
+        int offset = decode<int32_t>();
+        int lineStartOffset = decode<int32_t>();
+        return JSTextPosition(line, offset, lineStartOffset);
+    }
+
+private:
+    VM& m_vm;
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    bool m_failed;
+};
+
+// Walks the packed instructions the way UnlinkedInstructionStream::Reader
+// does, so a damaged file can't send the reader past the end.
+static bool isValidInstructionStream(const uint8_t* data, unsigned length, unsigned instructionCount)
+{
+    unsigned index = 0;
+    unsigned count = 0;
+    while (index < length) {
+        unsigned opcode = data[index++];
+        if (opcode >= static_cast<unsigned>(numOpcodeIDs))
+            return false;
+
+        int opcodeLength = opcodeLengths[opcode];
+        count += opcodeLength;
+        for (int i = 1; i < opcodeLength; ++i) {
+            if (index >= length)
+                return false;
+
+            switch (data[index] >> 5) {
+            case Positive5Bit:
+            case Negative5Bit:
+            case ConstantRegister5Bit:
+                index += 1;
+                break;
+            case Positive13Bit:
+            case Negative13Bit:
+            case ConstantRegister13Bit:
+                index += 2;
+                break;
+            case Full32Bit:
+                index += 5;
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    return index == length && count == instructionCount;
+}
+
+void CodeCacheStorage::encodeConstant(Encoder& encoder, JSValue value, UnlinkedCodeBlock* referencedFrom)
+{
+    if (!value) {
+        encoder.encode(EmptyConstant);
+        return;
+    }
+
+    if (value.isUndefined())
+        encoder.encode(UndefinedConstant);
+    else if (value.isNull())
+        encoder.encode(NullConstant);
+    else if (value.isBoolean())
+        encoder.encode(value.asBoolean() ? TrueConstant : FalseConstant);
+    else if (value.isInt32()) {
+        encoder.encode(Int32Constant);
+        encoder.encode<int32_t>(value.asInt32());
+    } else if (value.isDouble()) {
+        encoder.encode(DoubleConstant);
+        encoder.encode<double>(value.asDouble());
+    } else if (referencedFrom) {
+        // Cells in constant buffers are kept alive as constant registers
+        const Vector<WriteBarrier<Unknown>>& constants = referencedFrom->constantRegisters();
+        for (unsigned i = 0; i < constants.size(); ++i) {
+            if (constants[i].get() == value) {
+                encoder.encode(ConstantRegisterReference);
+                encoder.encode<uint32_t>(i);
+                return;
+            }
+        }
+        encoder.fail();
+    } else if (value.isString()) {
+        const StringImpl* impl = asString(value)->tryGetValueImpl();
+        if (!impl) {
+            encoder.fail();
+            return;
+        }
+        encoder.encode(StringConstant);
+        encoder.encode(String(const_cast<StringImpl*>(impl)));
+    } else if (SymbolTable* symbolTable = jsDynamicCast<SymbolTable*>(value)) {
+        // The only tables bytecode for program code makes, for catch blocks
+        ConcurrentJITLocker locker(symbolTable->m_lock);
+        if (symbolTable->size(locker) != 1) {
+            encoder.fail();
+            return;
+        }
+
+        SymbolTable::Map::iterator entry = symbolTable->begin(locker);
+        VarOffset offset = entry->value.varOffset();
+        if (!offset.isScope() || offset.scopeOffset() != ScopeOffset(0)) {
+            encoder.fail();
+            return;
+        }
+
+        encoder.encode(NameScopeConstant);
+        encoder.encode(Identifier::fromUid(&encoder.vm(), entry->key.get()));
+        encoder.encode<uint32_t>(entry->value.getAttributes());
+    } else
+        encoder.fail();
+}
+
+JSValue CodeCacheStorage::decodeConstant(Decoder& decoder, UnlinkedCodeBlock* referencedFrom)
+{
+    VM& vm = decoder.vm();
+
+    switch (decoder.decode<ConstantTag>()) {
+    case EmptyConstant:
+        return JSValue();
+    case UndefinedConstant:
+        return jsUndefined();
+    case NullConstant:
+        return jsNull();
+    case FalseConstant:
+        return jsBoolean(false);
+    case TrueConstant:
+        return jsBoolean(true);
+    case Int32Constant:
+        return jsNumber(decoder.decode<int32_t>());
+    case DoubleConstant:
+        return JSValue(JSValue::EncodeAsDouble, decoder.decode<double>());
+    case StringConstant: {
+        String string = decoder.decodeString();
+        if (string.isNull())
+            break;
+        return jsString(&vm, string);
+    }
+    case NameScopeConstant: {
+        Identifier name = decoder.decodeIdentifier();
+        unsigned attributes = decoder.decode<uint32_t>();
+        if (name.isNull())
+            break;
+        return SymbolTable::createNameScopeTable(vm, name, attributes);
+    }
+    case ConstantRegisterReference: {
+        unsigned index = decoder.decode<uint32_t>();
+        if (!referencedFrom || index >= referencedFrom->numberOfConstantRegisters())
+            break;
+        return referencedFrom->constantRegisters()[index].get();
+    }
+    }
+
+    decoder.fail();
+    return JSValue();
+}
+
+void CodeCacheStorage::encodeFunction(Encoder& encoder, UnlinkedFunctionExecutable* executable)
+{
+    // Builtins and default class constructors come from the VM, not the script
+    if (executable->m_sourceOverride || executable->isBuiltinFunction()) {
+        encoder.fail();
+        return;
+    }
+
+    encoder.encode(executable->m_name);
+    encoder.encode(executable->m_inferredName);
+
+    // Destructuring patterns are a piece of AST, only plain names are stored
+    FunctionParameters* parameters = executable->parameters();
+    encoder.encode<uint32_t>(parameters->size());
+    for (unsigned i = 0; i < parameters->size(); ++i) {
+        DeconstructionPatternNode* pattern = parameters->at(i);
+        if (!pattern->isBindingNode()) {
+            encoder.fail();
+            return;
+        }
+
+        BindingNode* binding = static_cast<BindingNode*>(pattern);
+        encoder.encode(binding->boundProperty());
+        encoder.encode(binding->divotStart());
+        encoder.encode(binding->divotEnd());
+    }
+
+    encoder.encode<uint32_t>(executable->m_firstLineOffset);
+    encoder.encode<uint32_t>(executable->m_lineCount);
+    encoder.encode<uint32_t>(executable->m_unlinkedFunctionNameStart);
+    encoder.encode<uint32_t>(executable->m_unlinkedBodyStartColumn);
+    encoder.encode<uint32_t>(executable->m_unlinkedBodyEndColumn);
+    encoder.encode<uint32_t>(executable->m_startOffset);
+    encoder.encode<uint32_t>(executable->m_sourceLength);
+    encoder.encode<uint32_t>(executable->m_parametersStartOffset);
+    encoder.encode<uint32_t>(executable->m_typeProfilingStartOffset);
+    encoder.encode<uint32_t>(executable->m_typeProfilingEndOffset);
+    encoder.encode<uint32_t>(executable->m_features);
+
+    encoder.encode<uint8_t>(executable->m_isInStrictContext);
+    encoder.encode<uint8_t>(executable->m_hasCapturedVariables);
+    encoder.encode<uint8_t>(executable->m_constructorKind);
+    encoder.encode<uint8_t>(executable->m_functionMode);
+}
+
+PassRefPtr<FunctionParameters> CodeCacheStorage::decodeParameters(Decoder& decoder)
+{
+    unsigned count = decoder.decodeCount();
+    Vector<RefPtr<DeconstructionPatternNode>> patterns;
+    patterns.reserveInitialCapacity(count);
+    for (unsigned i = 0; i < count; ++i) {
+        Identifier name = decoder.decodeIdentifier();
+        JSTextPosition start = decoder.decodePosition();
+        JSTextPosition end = decoder.decodePosition();
+        if (decoder.failed() || name.isNull()) {
+            decoder.fail();
+            return nullptr;
+        }
+        patterns.uncheckedAppend(BindingNode::create(name, start, end));
+    }
+
+    return FunctionParameters::create(patterns);
+}
+
+UnlinkedFunctionExecutable* CodeCacheStorage::decodeFunction(Decoder& decoder)
+{
+    VM& vm = decoder.vm();
+
+    Identifier name = decoder.decodeIdentifier();
+    Identifier inferredName = decoder.decodeIdentifier();
+    RefPtr<FunctionParameters> parameters = decodeParameters(decoder);
+    if (decoder.failed())
+        return nullptr;
+
+    UnlinkedFunctionExecutable* executable = new (NotNull, allocateCell<UnlinkedFunctionExecutable>(vm.heap))
+        UnlinkedFunctionExecutable(&vm, vm.unlinkedFunctionExecutableStructure.get(), name, inferredName, parameters.release());
+
+    executable->m_firstLineOffset = decoder.decode<uint32_t>();
+    executable->m_lineCount = decoder.decode<uint32_t>();
+    executable->m_unlinkedFunctionNameStart = decoder.decode<uint32_t>();
+    executable->m_unlinkedBodyStartColumn = decoder.decode<uint32_t>();
+    executable->m_unlinkedBodyEndColumn = decoder.decode<uint32_t>();
+    executable->m_startOffset = decoder.decode<uint32_t>();
+    executable->m_sourceLength = decoder.decode<uint32_t>();
+    executable->m_parametersStartOffset = decoder.decode<uint32_t>();
+    executable->m_typeProfilingStartOffset = decoder.decode<uint32_t>();
+    executable->m_typeProfilingEndOffset = decoder.decode<uint32_t>();
+    executable->m_features = decoder.decode<uint32_t>();
+
+    executable->m_isInStrictContext = decoder.decode<uint8_t>();
+    executable->m_hasCapturedVariables = decoder.decode<uint8_t>();
+    executable->m_constructorKind = decoder.decode<uint8_t>();
+    executable->m_functionMode = decoder.decode<uint8_t>();
+
+    executable->finishCreation(vm);
+    return executable;
+}
+
+void CodeCacheStorage::encodeCodeBlock(Encoder& encoder, UnlinkedCodeBlock* codeBlock)
+{
+    // Profilers bypass the cache, and global code has no symbol table
+    if (!codeBlock->m_typeProfilerInfoMap.isEmpty() || !codeBlock->m_opProfileControlFlowBytecodeOffsets.isEmpty() || codeBlock->m_symbolTable) {
+        encoder.fail();
+        return;
+    }
+
+    const UnlinkedInstructionStream& instructions = codeBlock->instructions();
+    encoder.encode<uint32_t>(instructions.count());
+    encoder.encode<uint32_t>(instructions.m_data.size());
+    encoder.encodeBytes(instructions.m_data.data(), instructions.m_data.size());
+
+    encoder.encode<int32_t>(codeBlock->m_numVars);
+    encoder.encode<int32_t>(codeBlock->m_numCapturedVars);
+    encoder.encode<int32_t>(codeBlock->m_numCalleeRegisters);
+    encoder.encode<int32_t>(codeBlock->m_numParameters);
+
+    encoder.encode<int32_t>(codeBlock->m_thisRegister.offset());
+    encoder.encode<int32_t>(codeBlock->m_scopeRegister.offset());
+    encoder.encode<int32_t>(codeBlock->m_lexicalEnvironmentRegister.offset());
+    encoder.encode<int32_t>(codeBlock->m_globalObjectRegister.offset());
+
+    encoder.encode<uint8_t>(codeBlock->m_needsFullScopeChain);
+    encoder.encode<uint8_t>(codeBlock->m_usesEval);
+    encoder.encode<uint8_t>(codeBlock->m_isStrictMode);
+    encoder.encode<uint8_t>(codeBlock->m_isConstructor);
+    encoder.encode<uint8_t>(codeBlock->m_hasCapturedVariables);
+    encoder.encode<uint8_t>(codeBlock->m_isBuiltinFunction);
+    encoder.encode<uint8_t>(codeBlock->m_constructorKind);
+
+    encoder.encode<uint32_t>(codeBlock->m_firstLine);
+    encoder.encode<uint32_t>(codeBlock->m_lineCount);
+    encoder.encode<uint32_t>(codeBlock->m_endColumn);
+    encoder.encode<uint32_t>(codeBlock->m_features);
+
+    encoder.encode(codeBlock->m_jumpTargets);
+
+    encoder.encode<uint32_t>(codeBlock->m_identifiers.size());
+    for (const Identifier& identifier : codeBlock->m_identifiers)
+        encoder.encode(identifier);
+
+    encoder.encode<uint32_t>(codeBlock->m_constantRegisters.size());
+    for (unsigned i = 0; i < codeBlock->m_constantRegisters.size(); ++i) {
+        encodeConstant(encoder, codeBlock->m_constantRegisters[i].get());
+        encoder.encode(codeBlock->m_constantsSourceCodeRepresentation[i]);
+    }
+    encoder.encode(codeBlock->m_linkTimeConstants);
+
+    encoder.encode<uint32_t>(codeBlock->m_functionDecls.size());
+    for (auto& function : codeBlock->m_functionDecls)
+        encodeFunction(encoder, function.get());
+    encoder.encode<uint32_t>(codeBlock->m_functionExprs.size());
+    for (auto& function : codeBlock->m_functionExprs)
+        encodeFunction(encoder, function.get());
+
+    encoder.encode(codeBlock->m_propertyAccessInstructions);
+
+    encoder.encode<uint32_t>(codeBlock->m_arrayProfileCount);
+    encoder.encode<uint32_t>(codeBlock->m_arrayAllocationProfileCount);
+    encoder.encode<uint32_t>(codeBlock->m_objectAllocationProfileCount);
+    encoder.encode<uint32_t>(codeBlock->m_valueProfileCount);
+    encoder.encode<uint32_t>(codeBlock->m_llintCallLinkInfoCount);
+
+    UnlinkedCodeBlock::RareData* rareData = codeBlock->m_rareData.get();
+    encoder.encode<uint8_t>(!!rareData);
+    if (rareData) {
+        encoder.encode(rareData->m_exceptionHandlers);
+
+        encoder.encode<uint32_t>(rareData->m_regexps.size());
+        for (auto& regExp : rareData->m_regexps) {
+            encoder.encode(regExp->pattern());
+            encoder.encode<uint8_t>((regExp->global() ? FlagGlobal : 0) | (regExp->ignoreCase() ? FlagIgnoreCase : 0) | (regExp->multiline() ? FlagMultiline : 0));
+        }
+
+        encoder.encode<uint32_t>(rareData->m_constantBuffers.size());
+        for (const UnlinkedCodeBlock::ConstantBuffer& buffer : rareData->m_constantBuffers) {
+            encoder.encode<uint32_t>(buffer.size());
+            for (JSValue value : buffer)
+                encodeConstant(encoder, value, codeBlock);
+        }
+
+        encoder.encode<uint32_t>(rareData->m_switchJumpTables.size());
+        for (const UnlinkedSimpleJumpTable& table : rareData->m_switchJumpTables) {
+            encoder.encode(table.branchOffsets);
+            encoder.encode<int32_t>(table.min);
+        }
+
+        encoder.encode<uint32_t>(rareData->m_stringSwitchJumpTables.size());
+        for (const UnlinkedStringJumpTable& table : rareData->m_stringSwitchJumpTables) {
+            encoder.encode<uint32_t>(table.offsetTable.size());
+            for (auto& entry : table.offsetTable) {
+                encoder.encode(String(entry.key.get()));
+                encoder.encode<int32_t>(entry.value);
+            }
+        }
+
+        encoder.encode(rareData->m_expressionInfoFatPositions);
+    }
+
+    encoder.encode(codeBlock->m_expressionInfo);
+}
+
+void CodeCacheStorage::decodeCodeBlock(Decoder& decoder, UnlinkedCodeBlock* codeBlock)
+{
+    VM& vm = decoder.vm();
+
+    unsigned instructionCount = decoder.decode<uint32_t>();
+    unsigned length = decoder.decodeCount();
+    const uint8_t* instructions = decoder.decodeBytes(length);
+    if (!instructions || !isValidInstructionStream(instructions, length, instructionCount)) {
+        decoder.fail();
+        return;
+    }
+    codeBlock->setInstructions(std::unique_ptr<UnlinkedInstructionStream>(new UnlinkedInstructionStream(instructions, length, instructionCount)));
+
+    codeBlock->m_numVars = decoder.decode<int32_t>();
+    codeBlock->m_numCapturedVars = decoder.decode<int32_t>();
+    codeBlock->m_numCalleeRegisters = decoder.decode<int32_t>();
+    codeBlock->m_numParameters = decoder.decode<int32_t>();
+
+    codeBlock->m_thisRegister = VirtualRegister(decoder.decode<int32_t>());
+    codeBlock->m_scopeRegister = VirtualRegister(decoder.decode<int32_t>());
+    codeBlock->m_lexicalEnvironmentRegister = VirtualRegister(decoder.decode<int32_t>());
+    codeBlock->m_globalObjectRegister = VirtualRegister(decoder.decode<int32_t>());
+
+    codeBlock->m_needsFullScopeChain = decoder.decode<uint8_t>();
+    codeBlock->m_usesEval = decoder.decode<uint8_t>();
+    codeBlock->m_isStrictMode = decoder.decode<uint8_t>();
+    codeBlock->m_isConstructor = decoder.decode<uint8_t>();
+    codeBlock->m_hasCapturedVariables = decoder.decode<uint8_t>();
+    codeBlock->m_isBuiltinFunction = decoder.decode<uint8_t>();
+    codeBlock->m_constructorKind = decoder.decode<uint8_t>();
+
+    codeBlock->m_firstLine = decoder.decode<uint32_t>();
+    codeBlock->m_lineCount = decoder.decode<uint32_t>();
+    codeBlock->m_endColumn = decoder.decode<uint32_t>();
+    codeBlock->m_features = decoder.decode<uint32_t>();
+
+    decoder.decode(codeBlock->m_jumpTargets);
+
+    unsigned count = decoder.decodeCount();
+    codeBlock->m_identifiers.reserveInitialCapacity(count);
+    for (unsigned i = 0; i < count; ++i)
+        codeBlock->m_identifiers.uncheckedAppend(decoder.decodeIdentifier());
+
+    count = decoder.decodeCount(2);
+    for (unsigned i = 0; i < count; ++i) {
+        JSValue value = decodeConstant(decoder);
+        SourceCodeRepresentation representation = decoder.decode<SourceCodeRepresentation>();
+        codeBlock->addConstant(value, representation);
+    }
+    codeBlock->m_linkTimeConstants = decoder.decode<std::array<unsigned, LinkTimeConstantCount>>();
+
+    count = decoder.decodeCount();
+    for (unsigned i = 0; i < count; ++i) {
+        UnlinkedFunctionExecutable* function = decodeFunction(decoder);
+        if (!function)
+            return;
+        codeBlock->addFunctionDecl(function);
+    }
+    count = decoder.decodeCount();
+    for (unsigned i = 0; i < count; ++i) {
+        UnlinkedFunctionExecutable* function = decodeFunction(decoder);
+        if (!function)
+            return;
+        codeBlock->addFunctionExpr(function);
+    }
+
+    decoder.decode(codeBlock->m_propertyAccessInstructions);
+
+    codeBlock->m_arrayProfileCount = decoder.decode<uint32_t>();
+    codeBlock->m_arrayAllocationProfileCount = decoder.decode<uint32_t>();
+    codeBlock->m_objectAllocationProfileCount = decoder.decode<uint32_t>();
+    codeBlock->m_valueProfileCount = decoder.decode<uint32_t>();
+    codeBlock->m_llintCallLinkInfoCount = decoder.decode<uint32_t>();
+
+    if (decoder.decode<uint8_t>()) {
+        codeBlock->createRareDataIfNecessary();
+        UnlinkedCodeBlock::RareData& rareData = *codeBlock->m_rareData;
+
+        decoder.decode(rareData.m_exceptionHandlers);
+
+        count = decoder.decodeCount(5);
+        for (unsigned i = 0; i < count; ++i) {
+            String pattern = decoder.decodeString();
+            unsigned flags = decoder.decode<uint8_t>();
+            if (pattern.isNull() || flags & ~(FlagGlobal | FlagIgnoreCase | FlagMultiline)) {
+                decoder.fail();
+                return;
+            }
+            codeBlock->addRegExp(RegExp::create(vm, pattern, static_cast<RegExpFlags>(flags)));
+        }
+
+        count = decoder.decodeCount(4);
+        for (unsigned i = 0; i < count; ++i) {
+            unsigned length = decoder.decodeCount();
+            UnlinkedCodeBlock::ConstantBuffer& buffer = codeBlock->constantBuffer(codeBlock->addConstantBuffer(length));
+            for (unsigned j = 0; j < length; ++j)
+                buffer[j] = decodeConstant(decoder, codeBlock);
+        }
+
+        count = decoder.decodeCount(8);
+        for (unsigned i = 0; i < count; ++i) {
+            UnlinkedSimpleJumpTable& table = codeBlock->addSwitchJumpTable();
+            decoder.decode(table.branchOffsets);
+            table.min = decoder.decode<int32_t>();
+        }
+
+        count = decoder.decodeCount(4);
+        for (unsigned i = 0; i < count; ++i) {
+            UnlinkedStringJumpTable& table = codeBlock->addStringSwitchJumpTable();
+            unsigned entries = decoder.decodeCount(8);
+            for (unsigned j = 0; j < entries; ++j) {
+                String key = decoder.decodeString();
+                int32_t offset = decoder.decode<int32_t>();
+                if (key.isNull()) {
+                    decoder.fail();
+                    return;
+                }
+                table.offsetTable.add(key.impl(), offset);
+            }
+        }
+
+        decoder.decode(rareData.m_expressionInfoFatPositions);
+    }
+
+    decoder.decode(codeBlock->m_expressionInfo);
+}
+
+void CodeCacheStorage::encodeProgram(Encoder& encoder, UnlinkedProgramCodeBlock* codeBlock)
+{
+    encodeCodeBlock(encoder, codeBlock);
+
+    const UnlinkedProgramCodeBlock::VariableDeclations& declarations = codeBlock->variableDeclarations();
+    encoder.encode<uint32_t>(declarations.size());
+    for (const auto& declaration : declarations) {
+        encoder.encode(declaration.first);
+        encoder.encode<uint8_t>(declaration.second);
+    }
+}
+
+UnlinkedProgramCodeBlock* CodeCacheStorage::decodeProgram(Decoder& decoder)
+{
+    VM& vm = decoder.vm();
+
+    // The flags ExecutableInfo carries come from the file
+    UnlinkedProgramCodeBlock* codeBlock = UnlinkedProgramCodeBlock::create(&vm, ExecutableInfo(false, false, false, false, false, ConstructorKind::None));
+    decodeCodeBlock(decoder, codeBlock);
+
+    unsigned count = decoder.decodeCount(2);
+    for (unsigned i = 0; i < count; ++i) {
+        Identifier name = decoder.decodeIdentifier();
+        bool isConstant = decoder.decode<uint8_t>();
+        codeBlock->addVariableDeclaration(name, isConstant);
+    }
+
+    if (decoder.failed() || !decoder.atEnd())
+        return nullptr;
+    return codeBlock;
+}
+
+static StaticSpinLock storageDirectoryLock;
+
+static String& sharedStorageDirectory()
+{
+    static NeverDestroyed<String> directory;
+    return directory;
+}
+
+// Worker VMs compile on their own threads, each use gets its own copy
+static String storageDirectory()
+{
+    SpinLockHolder locker(&storageDirectoryLock);
+    return sharedStorageDirectory().isolatedCopy();
+}
+
+static bool shouldUseStorage(const SourceCode& source)
+{
+    return static_cast<unsigned>(source.length()) >= minimumSourceLength
+        && !Options::forceDebuggerBytecodeGeneration()
+        && !Options::forceProfilerBytecodeGeneration();
+}
+
+static SHA1::Digest sourceDigest(const SourceCode& source, JSParserStrictMode strictMode)
+{
+    SHA1 sha1;
+    sha1.addBytes(reinterpret_cast<const uint8_t*>(formatVersion), sizeof(formatVersion));
+    sha1.addBytes(reinterpret_cast<const uint8_t*>(opcodeStamp), sizeof(opcodeStamp));
+
+    String string = source.toString();
+    uint8_t flags[] = { static_cast<uint8_t>(strictMode), string.is8Bit() };
+    sha1.addBytes(flags, sizeof(flags));
+    if (string.is8Bit())
+        sha1.addBytes(string.characters8(), string.length());
+    else
+        sha1.addBytes(reinterpret_cast<const uint8_t*>(string.characters16()), string.length() * sizeof(UChar));
+
+    SHA1::Digest digest;
+    sha1.computeHash(digest);
+    return digest;
+}
+
+// Operands index into the code block's tables unchecked, so a flipped bit
+// anywhere in the payload has to be caught before decoding
+static SHA1::Digest payloadDigest(const uint8_t* data, size_t length)
+{
+    SHA1 sha1;
+    sha1.addBytes(data, length);
+
+    SHA1::Digest digest;
+    sha1.computeHash(digest);
+    return digest;
+}
+
+static CString entryPath(const String& directory, const SHA1::Digest& digest)
+{
+    StringBuilder path;
+    path.append(directory);
+    path.append('/');
+    path.append(SHA1::hexDigest(digest).data());
+    return path.toString().utf8();
+}
+
+#if OS(UNIX)
+
+void CodeCacheStorage::setDirectory(const String& directory)
+{
+    String copy = directory.isolatedCopy();
+    {
+        SpinLockHolder locker(&storageDirectoryLock);
+        sharedStorageDirectory().swap(copy);
+    }
+    if (!directory.isNull())
+        mkdir(directory.utf8().data(), 0700);
+}
+
+UnlinkedProgramCodeBlock* CodeCacheStorage::load(VM& vm, const SourceCode& source, JSParserStrictMode strictMode)
+{
+    String directory = storageDirectory();
+    if (directory.isNull() || !shouldUseStorage(source))
+        return nullptr;
+
+    SHA1::Digest digest = sourceDigest(source, strictMode);
+    int fd = open(entryPath(directory, digest).data(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat status;
+    if (fstat(fd, &status) || !status.st_size) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t length = status.st_size;
+    void* data = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    Decoder decoder(vm, static_cast<const uint8_t*>(data), length);
+    UnlinkedProgramCodeBlock* codeBlock = nullptr;
+    const uint8_t* header = decoder.decodeBytes(sizeof(magic));
+    if (header && !memcmp(header, magic, sizeof(magic))
+        && decoder.decode<SHA1::Digest>() == digest
+        && decoder.decode<uint32_t>() == static_cast<unsigned>(source.length())) {
+        SHA1::Digest storedPayloadDigest = decoder.decode<SHA1::Digest>();
+        if (!decoder.failed() && storedPayloadDigest == payloadDigest(decoder.position(), decoder.remaining()))
+            codeBlock = decodeProgram(decoder);
+    }
+
+    munmap(data, length);
+    return codeBlock;
+}
+
+// Written under a temporary name, so readers only see whole files
+static void writeFile(const CString& path, const Vector<uint8_t>& data)
+{
+    Vector<char> temporaryPath;
+    temporaryPath.append(path.data(), path.length());
+    temporaryPath.append(".XXXXXX", sizeof(".XXXXXX"));
+    int fd = mkstemp(temporaryPath.data());
+    if (fd < 0)
+        return;
+
+    const uint8_t* remaining = data.data();
+    size_t length = data.size();
+    while (length) {
+        ssize_t written = write(fd, remaining, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        remaining += written;
+        length -= written;
+    }
+
+    if (close(fd) || length || rename(temporaryPath.data(), path.data()))
+        unlink(temporaryPath.data());
+}
+
+void CodeCacheStorage::store(const SourceCode& source, JSParserStrictMode strictMode, UnlinkedProgramCodeBlock* codeBlock)
+{
+    String directory = storageDirectory();
+    if (directory.isNull() || !shouldUseStorage(source))
+        return;
+
+    SHA1::Digest digest = sourceDigest(source, strictMode);
+
+    Encoder encoder(*codeBlock->vm());
+    encoder.encodeBytes(magic, sizeof(magic));
+    encoder.encode(digest);
+    encoder.encode<uint32_t>(source.length());
+    size_t payloadDigestOffset = encoder.size();
+    encoder.encode(SHA1::Digest());
+    size_t payloadOffset = encoder.size();
+    encodeProgram(encoder, codeBlock);
+    if (encoder.failed())
+        return;
+
+    encoder.encodeAt(payloadDigestOffset, payloadDigest(encoder.buffer().data() + payloadOffset, encoder.size() - payloadOffset));
+    writeFile(entryPath(directory, digest), encoder.buffer());
+}
+
+#else
+
+void CodeCacheStorage::setDirectory(const String&)
+{
+}
+
+UnlinkedProgramCodeBlock* CodeCacheStorage::load(VM&, const SourceCode&, JSParserStrictMode)
+{
+    return nullptr;
+}
+
+void CodeCacheStorage::store(const SourceCode&, JSParserStrictMode, UnlinkedProgramCodeBlock*)
+{
+}
+
+#endif // OS(UNIX)
+
+} // namespace JSC
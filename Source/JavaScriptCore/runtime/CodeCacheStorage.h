@@ -0,0 +1,66 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CodeCacheStorage_h
+#define CodeCacheStorage_h
+
+#include "ParserModes.h"
+#include <wtf/Forward.h>
+
+namespace JSC {
+
+class FunctionParameters;
+class JSValue;
+class SourceCode;
+class UnlinkedCodeBlock;
+class UnlinkedFunctionExecutable;
+class UnlinkedProgramCodeBlock;
+class VM;
+
+// Keeps the bytecode of top-level program code in a directory, so scripts
+// seen in an earlier run skip parsing and bytecode generation. A file is
+// named by the SHA-1 of the source text and the bytecode format, and read
+// back through mmap when the in-memory CodeCache misses. Functions inside
+// are stored unlinked, they compile lazily from source as usual.
+//
+// Scripts using something the format can't express are simply not stored.
+class CodeCacheStorage {
+public:
+    // A null directory, the default, turns the storage off
+    JS_EXPORT_PRIVATE static void setDirectory(const String&);
+
+    static UnlinkedProgramCodeBlock* load(VM&, const SourceCode&, JSParserStrictMode);
+    static void store(const SourceCode&, JSParserStrictMode, UnlinkedProgramCodeBlock*);
+
+private:
+    class Encoder;
+    class Decoder;
+
+    static void encodeProgram(Encoder&, UnlinkedProgramCodeBlock*);
+    static void encodeCodeBlock(Encoder&, UnlinkedCodeBlock*);
+    static void encodeFunction(Encoder&, UnlinkedFunctionExecutable*);
+    static void encodeConstant(Encoder&, JSValue, UnlinkedCodeBlock* referencedFrom = nullptr);
+
+    static UnlinkedProgramCodeBlock* decodeProgram(Decoder&);
+    static void decodeCodeBlock(Decoder&, UnlinkedCodeBlock*);
+    static UnlinkedFunctionExecutable* decodeFunction(Decoder&);
+    static PassRefPtr<FunctionParameters> decodeParameters(Decoder&);
+    static JSValue decodeConstant(Decoder&, UnlinkedCodeBlock* referencedFrom = nullptr);
+};
+
+} // namespace JSC
+
+#endif // CodeCacheStorage_h
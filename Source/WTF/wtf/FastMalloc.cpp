@@ -171,6 +171,12 @@ FastMallocStatistics fastMallocStatistics()
     return statistics;
 }
 
+FastMallocDetailedStatistics fastMallocDetailedStatistics()
+{
+    FastMallocDetailedStatistics statistics = { };
+    return statistics;
+}
+
 size_t fastMallocSize(const void* p)
 {
 #if OS(DARWIN)
@@ -264,10 +270,36 @@ void releaseFastMallocFreeMemory()
     bmalloc::api::scavenge();
 }
 
+static void convertStatistics(const bmalloc::ObjectTypeStatistics& from, FastMallocClassStatistics& to)
+{
+    to.committedVMBytes = from.committedBytes;
+    to.freeListBytes = from.freeBytes;
+    to.pageCount = from.pageCount;
+    to.pagesInUse = from.pagesInUse;
+    to.lineCount = from.lineCount;
+    to.linesInUse = from.linesInUse;
+}
+
 FastMallocStatistics fastMallocStatistics()
 {
-    // FIXME: This is incorrect; needs an implementation or to be removed.
-    FastMallocStatistics statistics = { 0, 0, 0 };
+    bmalloc::HeapStatistics heapStatistics = bmalloc::api::statistics();
+    FastMallocStatistics statistics = { heapStatistics.reservedBytes, 0, 0 };
+    for (const bmalloc::ObjectTypeStatistics* each : { &heapStatistics.small, &heapStatistics.medium, &heapStatistics.large, &heapStatistics.xLarge }) {
+        statistics.committedVMBytes += each->committedBytes;
+        statistics.freeListBytes += each->freeBytes;
+    }
+    return statistics;
+}
+
+FastMallocDetailedStatistics fastMallocDetailedStatistics()
+{
+    bmalloc::HeapStatistics heapStatistics = bmalloc::api::statistics();
+    FastMallocDetailedStatistics statistics;
+    statistics.reservedVMBytes = heapStatistics.reservedBytes;
+    convertStatistics(heapStatistics.small, statistics.small);
+    convertStatistics(heapStatistics.medium, statistics.medium);
+    convertStatistics(heapStatistics.large, statistics.large);
+    convertStatistics(heapStatistics.xLarge, statistics.xLarge);
     return statistics;
 }
 
@@ -68,6 +68,25 @@ struct FastMallocStatistics {
 };
 WTF_EXPORT_PRIVATE FastMallocStatistics fastMallocStatistics();
 
+// The same by size class; zero with the system malloc. Pages and lines are
+// only counted for small and medium objects.
+struct FastMallocClassStatistics {
+    size_t committedVMBytes;
+    size_t freeListBytes;
+    size_t pageCount;
+    size_t pagesInUse;
+    size_t lineCount;
+    size_t linesInUse;
+};
+struct FastMallocDetailedStatistics {
+    size_t reservedVMBytes;
+    FastMallocClassStatistics small;
+    FastMallocClassStatistics medium;
+    FastMallocClassStatistics large;
+    FastMallocClassStatistics xLarge;
+};
+WTF_EXPORT_PRIVATE FastMallocDetailedStatistics fastMallocDetailedStatistics();
+
 // This defines a type which holds an unsigned integer and is the same
 // size as the minimally aligned memory allocation.
 typedef unsigned long long AllocAlignmentInteger;
@@ -101,6 +101,12 @@ public:
         bool m_isRepeating;
 #elif USE(GLIB)
         GMainLoopSource m_timerSource;
+#elif PLATFORM(FLTK)
+        static void timerFired(void*);
+        double m_interval;
+        double m_fireTime;
+        bool m_isRepeating;
+        bool m_isActive;
 #endif
     };
 
@@ -160,6 +166,18 @@ public:
 private:
     GRefPtr<GMainContext> m_mainContext;
     Vector<GRefPtr<GMainLoop>> m_mainLoops;
+#elif PLATFORM(FLTK)
+    // The main thread's loop is Fl::wait, others run their own
+    static void wakeUpEvent(int, void*);
+    void runSecondaryLoop();
+    bool m_usesFLTK;
+    int m_wakeUpPipe[2];
+
+    Mutex m_loopLock;
+    ThreadCondition m_loopCondition;
+    bool m_wakeUpPending;
+    bool m_stopRequested;
+    Vector<TimerBase*> m_timers;
 #endif
 };
 
@@ -110,6 +110,9 @@ private:
     GMainLoopSource m_socketEventSource;
 #elif PLATFORM(EFL)
     RefPtr<DispatchQueue> m_dispatchQueue;
+#elif PLATFORM(FLTK)
+    class ThreadPool;
+    ThreadPool* m_pool;
 #elif OS(WINDOWS)
     volatile LONG m_isWorkThreadRegistered;
 
@@ -30,30 +30,43 @@
 #include "config.h"
 #include "MainThread.h"
 
+#include <atomic>
 #include <FL/Fl.H>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 namespace WTF {
 
-static int pipefd[2];
+// Any number of posts between two main loop iterations cost one wakeup.
+// dispatchFunctionsFromMainThread drains in a time budget and schedules
+// again if anything is left.
+static int wakeupfd = -1;
+static std::atomic<bool> pending(false);
 
 static void handler(FL_SOCKET fd, void *) {
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0) { }
+
+	// Cleared before draining, so a post made meanwhile wakes us again
+	pending.store(false);
 	dispatchFunctionsFromMainThread();
-	char a;
-	read(fd, &a, 1);
 }
 
 void initializeMainThreadPlatform()
 {
-	if (pipe(pipefd) == -1)
+	wakeupfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeupfd == -1)
 		exit(1);
-	Fl::add_fd(pipefd[0], FL_READ, handler);
+	Fl::add_fd(wakeupfd, FL_READ, handler);
 }
 
 void scheduleDispatchFunctionsOnMainThread()
 {
-	char a = 0;
-	write(pipefd[1], &a, 1);
+	if (pending.exchange(true))
+		return;
+
+	const uint64_t one = 1;
+	if (write(wakeupfd, &one, sizeof(one)) < 0) { }
 }
 
 } // namespace WTF
@@ -27,72 +27,158 @@
 #include "config.h"
 #include "RunLoop.h"
 
+#include <FL/Fl.H>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+#include <wtf/CurrentTime.h>
 #include <wtf/MainThread.h>
 
-#define notImplemented() puts(__PRETTY_FUNCTION__)
-
 namespace WTF {
 
 RunLoop::RunLoop()
+    : m_usesFLTK(isMainThread())
+    , m_wakeUpPending(false)
+    , m_stopRequested(false)
 {
-	notImplemented();
-/* FIXME
-    m_runLoopContext = isMainThread() ? g_main_context_default() : adoptGRef(g_main_context_new());
-    ASSERT(m_runLoopContext);
-    GRefPtr<GMainLoop> innermostLoop = adoptGRef(g_main_loop_new(m_runLoopContext.get(), FALSE));
-    ASSERT(innermostLoop);
-    m_runLoopMainLoops.append(innermostLoop);*/
+    m_wakeUpPipe[0] = m_wakeUpPipe[1] = -1;
+    if (!m_usesFLTK)
+        return;
+
+    if (pipe(m_wakeUpPipe) == -1)
+        CRASH();
+    fcntl(m_wakeUpPipe[0], F_SETFL, O_NONBLOCK);
+    Fl::add_fd(m_wakeUpPipe[0], FL_READ, wakeUpEvent, this);
 }
 
 RunLoop::~RunLoop()
 {
-/*    for (int i = m_runLoopMainLoops.size() - 1; i >= 0; --i) {
-        if (!g_main_loop_is_running(m_runLoopMainLoops[i].get()))
-            continue;
-        g_main_loop_quit(m_runLoopMainLoops[i].get());
-    } FIXME
-    */
+    if (m_usesFLTK) {
+        Fl::remove_fd(m_wakeUpPipe[0]);
+        close(m_wakeUpPipe[0]);
+        close(m_wakeUpPipe[1]);
+        return;
+    }
+
+    MutexLocker locker(m_loopLock);
+    m_stopRequested = true;
+    m_loopCondition.signal();
+}
+
+void RunLoop::wakeUpEvent(int fd, void* data)
+{
+    RunLoop* runLoop = static_cast<RunLoop*>(data);
+
+    char buf[64];
+    while (read(fd, buf, sizeof(buf)) > 0) { }
+
+    {
+        MutexLocker locker(runLoop->m_loopLock);
+        runLoop->m_wakeUpPending = false;
+    }
+
+    runLoop->performWork();
 }
 
 void RunLoop::run()
 {
-	notImplemented();
-/*    RunLoop& mainRunLoop = RunLoop::current();
-    GMainLoop* innermostLoop = mainRunLoop.innermostLoop();
-    if (!g_main_loop_is_running(innermostLoop)) {
-        g_main_loop_run(innermostLoop);
+    RunLoop& runLoop = RunLoop::current();
+    if (!runLoop.m_usesFLTK) {
+        runLoop.runSecondaryLoop();
         return;
     }
 
-    // Create and run a nested loop if the innermost one was already running.
-    GMainLoop* nestedMainLoop = g_main_loop_new(0, FALSE);
-    mainRunLoop.pushNestedMainLoop(nestedMainLoop);
-    g_main_loop_run(nestedMainLoop);
-    mainRunLoop.popNestedMainLoop(); FIXME*/
+    // Nested runs spin Fl::wait until the innermost one is stopped
+    while (true) {
+        {
+            MutexLocker locker(runLoop.m_loopLock);
+            if (runLoop.m_stopRequested) {
+                runLoop.m_stopRequested = false;
+                return;
+            }
+        }
+        Fl::wait(1e20);
+    }
+}
+
+void RunLoop::runSecondaryLoop()
+{
+    m_loopLock.lock();
+    while (!m_stopRequested) {
+        if (m_wakeUpPending) {
+            m_wakeUpPending = false;
+            m_loopLock.unlock();
+            performWork();
+            m_loopLock.lock();
+            continue;
+        }
+
+        const double now = monotonicallyIncreasingTime();
+        double nextFireTime = std::numeric_limits<double>::infinity();
+        TimerBase* due = nullptr;
+        for (TimerBase* timer : m_timers) {
+            if (timer->m_fireTime <= now) {
+                due = timer;
+                break;
+            }
+            nextFireTime = std::min(nextFireTime, timer->m_fireTime);
+        }
+
+        if (due) {
+            if (due->m_isRepeating)
+                due->m_fireTime = now + due->m_interval;
+            else {
+                due->m_isActive = false;
+                m_timers.remove(m_timers.find(due));
+            }
+            m_loopLock.unlock();
+            due->fired();
+            m_loopLock.lock();
+            continue;
+        }
+
+        if (nextFireTime == std::numeric_limits<double>::infinity())
+            m_loopCondition.wait(m_loopLock);
+        else
+            m_loopCondition.timedWait(m_loopLock, currentTime() + nextFireTime - now);
+    }
+    m_stopRequested = false;
+    m_loopLock.unlock();
 }
 
 void RunLoop::stop()
 {
-	notImplemented();
-    // The innermost main loop should always be there.
-/*    ASSERT(!m_runLoopMainLoops.isEmpty());
-    GRefPtr<GMainLoop> lastMainLoop = m_runLoopMainLoops.last();
-    if (g_main_loop_is_running(lastMainLoop.get()))
-        g_main_loop_quit(lastMainLoop.get());*/
+    MutexLocker locker(m_loopLock);
+    m_stopRequested = true;
+
+    if (m_usesFLTK) {
+        // Make Fl::wait return
+        char a = 0;
+        if (write(m_wakeUpPipe[1], &a, 1) < 0) { }
+    } else
+        m_loopCondition.signal();
 }
 
 void RunLoop::wakeUp()
 {
-	notImplemented();
-/*    RefPtr<RunLoop> runLoop(this);
-    GMainLoopSource::createAndDeleteOnDestroy().schedule("[WebKit] RunLoop work", std::function<void()>([runLoop] {
-        runLoop->performWork();
-    }), G_PRIORITY_DEFAULT, nullptr, m_runLoopContext.get());
-    g_main_context_wakeup(m_runLoopContext.get());*/
+    MutexLocker locker(m_loopLock);
+    if (m_wakeUpPending)
+        return;
+    m_wakeUpPending = true;
+
+    if (m_usesFLTK) {
+        char a = 0;
+        if (write(m_wakeUpPipe[1], &a, 1) < 0) { }
+    } else
+        m_loopCondition.signal();
 }
 
 RunLoop::TimerBase::TimerBase(RunLoop& runLoop)
     : m_runLoop(runLoop)
+    , m_interval(0)
+    , m_fireTime(0)
+    , m_isRepeating(false)
+    , m_isActive(false)
 {
 }
 
@@ -101,24 +187,57 @@ RunLoop::TimerBase::~TimerBase()
     stop();
 }
 
+void RunLoop::TimerBase::timerFired(void* data)
+{
+    TimerBase* timer = static_cast<TimerBase*>(data);
+
+    if (timer->m_isRepeating)
+        Fl::repeat_timeout(timer->m_interval, timerFired, timer);
+    else
+        timer->m_isActive = false;
+
+    timer->fired();
+}
+
 void RunLoop::TimerBase::start(double fireInterval, bool repeat)
 {
-	notImplemented();
-/*    m_timerSource.scheduleAfterDelay("[WebKit] RunLoop::Timer", std::function<bool 
-()>([this, repeat] { fired(); return repeat; }),
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(fireInterval)), G_PRIORITY_DEFAULT, nullptr, m_runLoop.m_runLoopContext.get());*/
+    stop();
+
+    m_interval = fireInterval;
+    m_isRepeating = repeat;
+
+    if (m_runLoop.m_usesFLTK) {
+        m_isActive = true;
+        Fl::add_timeout(fireInterval, timerFired, this);
+        return;
+    }
+
+    MutexLocker locker(m_runLoop.m_loopLock);
+    m_isActive = true;
+    m_fireTime = monotonicallyIncreasingTime() + fireInterval;
+    m_runLoop.m_timers.append(this);
+    m_runLoop.m_loopCondition.signal();
 }
 
 void RunLoop::TimerBase::stop()
 {
-	notImplemented();
-    //m_timerSource.cancel();
+    if (m_runLoop.m_usesFLTK) {
+        if (m_isActive)
+            Fl::remove_timeout(timerFired, this);
+        m_isActive = false;
+        return;
+    }
+
+    MutexLocker locker(m_runLoop.m_loopLock);
+    if (!m_isActive)
+        return;
+    m_isActive = false;
+    m_runLoop.m_timers.remove(m_runLoop.m_timers.find(this));
 }
 
 bool RunLoop::TimerBase::isActive() const
 {
-	notImplemented();
-    //return m_timerSource.isScheduled();
+    return m_isActive;
 }
 
 } // namespace WTF
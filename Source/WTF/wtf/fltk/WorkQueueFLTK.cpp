@@ -0,0 +1,144 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include "WorkQueue.h"
+
+#include <limits>
+#include <wtf/CurrentTime.h>
+#include <wtf/Deque.h>
+#include <wtf/NumberOfCores.h>
+#include <wtf/RefPtr.h>
+#include <wtf/ThreadSafeRefCounted.h>
+#include <wtf/Vector.h>
+
+namespace WTF {
+
+// Shared between the queue and its threads, so that a queue released from
+// one of its own work items doesn't pull the lock out from under them.
+// A serial queue has one thread, a concurrent one a thread per core.
+class WorkQueue::ThreadPool : public ThreadSafeRefCounted<ThreadPool> {
+public:
+    struct DelayedFunction {
+        double fireTime;
+        std::function<void ()> function;
+    };
+
+    Mutex lock;
+    ThreadCondition condition;
+    Deque<std::function<void ()>> functions;
+    Vector<DelayedFunction> delayedFunctions;
+    bool invalidated { false };
+
+    static void threadEntry(void*);
+    void run();
+};
+
+void WorkQueue::ThreadPool::threadEntry(void* context)
+{
+    ThreadPool* pool = static_cast<ThreadPool*>(context);
+    pool->run();
+    pool->deref();
+}
+
+void WorkQueue::ThreadPool::run()
+{
+    lock.lock();
+    while (true) {
+        const double now = monotonicallyIncreasingTime();
+        double nextFireTime = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < delayedFunctions.size(); ) {
+            if (delayedFunctions[i].fireTime <= now) {
+                functions.append(WTF::move(delayedFunctions[i].function));
+                delayedFunctions.remove(i);
+                continue;
+            }
+            nextFireTime = std::min(nextFireTime, delayedFunctions[i].fireTime);
+            i++;
+        }
+
+        if (!functions.isEmpty()) {
+            std::function<void ()> function = functions.takeFirst();
+            lock.unlock();
+            function();
+            // May drop the last reference to the queue
+            function = nullptr;
+            lock.lock();
+            continue;
+        }
+
+        if (invalidated)
+            break;
+
+        if (nextFireTime == std::numeric_limits<double>::infinity())
+            condition.wait(lock);
+        else
+            condition.timedWait(lock, currentTime() + nextFireTime - now);
+    }
+    lock.unlock();
+}
+
+void WorkQueue::platformInitialize(const char* name, Type type, QOS)
+{
+    m_pool = new ThreadPool;
+
+    const int threads = type == Type::Concurrent ? std::max(numberOfProcessorCores(), 1) : 1;
+    for (int i = 0; i < threads; i++) {
+        m_pool->ref();
+        ThreadIdentifier thread = createThread(ThreadPool::threadEntry, m_pool, name);
+        if (!thread) {
+            m_pool->deref();
+            CRASH();
+        }
+        detachThread(thread);
+    }
+}
+
+void WorkQueue::platformInvalidate()
+{
+    {
+        MutexLocker locker(m_pool->lock);
+        m_pool->invalidated = true;
+        m_pool->condition.broadcast();
+    }
+    m_pool->deref();
+    m_pool = nullptr;
+}
+
+void WorkQueue::dispatch(std::function<void ()> function)
+{
+    RefPtr<WorkQueue> protector(this);
+
+    MutexLocker locker(m_pool->lock);
+    m_pool->functions.append([protector, function] {
+        function();
+    });
+    m_pool->condition.signal();
+}
+
+void WorkQueue::dispatchAfter(std::chrono::nanoseconds duration, std::function<void ()> function)
+{
+    RefPtr<WorkQueue> protector(this);
+    const double delay = std::chrono::duration<double>(duration).count();
+
+    MutexLocker locker(m_pool->lock);
+    m_pool->delayedFunctions.append({ monotonicallyIncreasingTime() + delay, [protector, function] {
+        function();
+    } });
+    m_pool->condition.signal();
+}
+
+}
@@ -115,8 +115,10 @@ list(APPEND WebCore_SOURCES
     platform/network/curl/CredentialStorageCurl.cpp
     platform/network/curl/CurlCacheEntry.cpp
     platform/network/curl/CurlCacheManager.cpp
+    platform/network/curl/CurlCookieStore.cpp
     platform/network/curl/CurlDownload.cpp
     platform/network/curl/DNSCurl.cpp
+    platform/network/curl/FileURL.cpp
     platform/network/curl/FormDataStreamCurl.cpp
     platform/network/curl/MultipartHandle.cpp
     platform/network/curl/ProxyServerCurl.cpp
@@ -111,7 +111,8 @@ const PlatformFileHandle invalidPlatformFileHandle = -1;
 
 enum FileOpenMode {
     OpenForRead = 0,
-    OpenForWrite
+    OpenForWrite,
+    OpenForAppend
 };
 
 enum FileSeekOrigin {
@@ -61,6 +61,8 @@ BitmapImage::BitmapImage(ImageObserver* observer)
     // FIXME: We should expose a setting to enable/disable progressive loading remove the PLATFORM(IOS)-guard.
     , m_progressiveLoadChunkTime(0)
     , m_progressiveLoadChunkCount(0)
+#endif
+#if PLATFORM(IOS) || PLATFORM(FLTK)
     , m_allowSubsampling(true)
 #else
     , m_allowSubsampling(false)
@@ -74,6 +76,11 @@ BitmapImage::BitmapImage(ImageObserver* observer)
     , m_hasUniformFrameSize(true)
     , m_haveFrameCount(false)
     , m_animationFinishedWhenCatchingUp(false)
+#if PLATFORM(FLTK)
+    , m_asyncDecodePending(false)
+    , m_asyncDecodeFailed(false)
+    , m_weakPtrFactory(this)
+#endif
 {
 }
 
@@ -38,6 +38,10 @@
 #include <wtf/RetainPtr.h>
 #endif
 
+#if PLATFORM(FLTK)
+#include <wtf/WeakPtr.h>
+#endif
+
 #if USE(APPKIT)
 OBJC_CLASS NSImage;
 #endif
@@ -227,6 +231,13 @@ protected:
     enum ImageFrameCaching { CacheMetadataOnly, CacheMetadataAndFrame };
     void cacheFrame(size_t index, SubsamplingLevel, ImageFrameCaching = CacheMetadataAndFrame);
 
+#if PLATFORM(FLTK)
+    // Large single frame images are decoded on another thread. Returns true
+    // while that is under way, m_frames holds a coarser frame or nothing.
+    bool decodeFrameAsync(size_t index, float presentationScaleHint);
+    void didDecodeFrameAsync(SubsamplingLevel, PassNativeImagePtr, bool hasAlpha);
+#endif
+
     // Called before accessing m_frames[index] for info without decoding. Returns false on index out of bounds.
     bool ensureFrameIsCached(size_t index, ImageFrameCaching = CacheMetadataAndFrame);
 
@@ -339,8 +350,15 @@ private:
     mutable bool m_hasUniformFrameSize : 1;
     mutable bool m_haveFrameCount : 1;
     bool m_animationFinishedWhenCatchingUp : 1;
+#if PLATFORM(FLTK)
+    bool m_asyncDecodePending : 1;
+    bool m_asyncDecodeFailed : 1;
+#endif
 
     RefPtr<Image> m_cachedImage;
+#if PLATFORM(FLTK)
+    WeakPtrFactory<BitmapImage> m_weakPtrFactory;
+#endif
 };
 
 } // namespace WebCore
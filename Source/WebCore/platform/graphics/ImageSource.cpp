@@ -35,6 +35,12 @@
 
 #include "ImageOrientation.h"
 #include "NotImplemented.h"
+#include "SharedBuffer.h"
+
+#if PLATFORM(FLTK)
+#include <wtf/MainThread.h>
+#include <wtf/WorkQueue.h>
+#endif
 
 namespace WebCore {
 
@@ -96,16 +102,101 @@ String ImageSource::filenameExtension() const
     return m_decoder ? m_decoder->filenameExtension() : String();
 }
 
-SubsamplingLevel ImageSource::subsamplingLevelForScale(float) const
+// Up to 1/8, the most JPEG can do in its IDCT
+static const SubsamplingLevel maxSubsamplingLevel = 3;
+
+// The smallest level that still has at least as many pixels as are drawn
+SubsamplingLevel ImageSource::subsamplingLevelForScale(float scale) const
 {
-    return 0;
+    if (!(scale > 0))
+        return 0;
+
+    SubsamplingLevel level = 0;
+    while (level < maxSubsamplingLevel && scale * (1 << (level + 1)) <= 1)
+        level++;
+    return level;
+}
+
+// Animated images composite frames onto each other, those stay at full size
+bool ImageSource::allowSubsamplingOfFrameAtIndex(size_t index) const
+{
+    return m_decoder && !index && m_decoder->supportsSubsampling() && m_decoder->frameCount() == 1;
+}
+
+// A decoder works at one level, so a different one means starting over
+void ImageSource::setSubsamplingLevel(SubsamplingLevel level)
+{
+    RefPtr<SharedBuffer> data = m_decoder->data();
+    if (!data)
+        return;
+
+    NativeImageDecoderPtr decoder = static_cast<NativeImageDecoderPtr>(NativeImageDecoder::create(*data, m_alphaOption, m_gammaAndColorProfileOption));
+    if (!decoder)
+        return;
+#if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
+    if (s_maxPixelsPerDecodedImage)
+        decoder->setMaxNumPixels(s_maxPixelsPerDecodedImage);
+#endif
+    decoder->setSubsamplingLevel(level);
+    decoder->setData(data.get(), m_decoder->isAllDataReceived());
+
+    delete m_decoder;
+    m_decoder = decoder;
 }
 
-bool ImageSource::allowSubsamplingOfFrameAtIndex(size_t) const
+#if PLATFORM(FLTK)
+static WorkQueue& imageDecodingQueue()
 {
-    return false;
+    static WorkQueue& queue = WorkQueue::create("org.webkit.ImageDecoder", WorkQueue::Type::Concurrent, WorkQueue::QOS::UserInitiated).leakRef();
+    return queue;
 }
 
+void ImageSource::createFrameAsync(size_t index, SubsamplingLevel subsamplingLevel, AsyncFrameHandler completionHandler)
+{
+    ASSERT(isMainThread());
+    ASSERT(m_decoder && m_decoder->isAllDataReceived());
+
+    // SharedBuffer isn't thread safe, the decoding thread gets its own copy
+    // and the only reference to it.
+    SharedBuffer* data = m_decoder->data();
+    SharedBuffer* copy = SharedBuffer::create(data->data(), data->size()).leakRef();
+    AlphaOption alphaOption = m_alphaOption;
+    GammaAndColorProfileOption gammaAndColorProfileOption = m_gammaAndColorProfileOption;
+    bool subsample = !subsamplingLevel || allowSubsamplingOfFrameAtIndex(index);
+
+    imageDecodingQueue().dispatch([=] {
+        RefPtr<SharedBuffer> data = adoptRef(copy);
+        NativeImagePtr image;
+        bool hasAlpha = true;
+
+        std::unique_ptr<ImageDecoder> decoder(ImageDecoder::create(*data, alphaOption, gammaAndColorProfileOption));
+        if (decoder) {
+#if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
+            if (s_maxPixelsPerDecodedImage)
+                decoder->setMaxNumPixels(s_maxPixelsPerDecodedImage);
+#endif
+            if (subsample)
+                decoder->setSubsamplingLevel(subsamplingLevel);
+            decoder->setData(data.get(), true);
+
+            ImageFrame* buffer = decoder->frameBufferAtIndex(index);
+            if (buffer && buffer->status() == ImageFrame::FrameComplete && !decoder->size().isEmpty()) {
+                image = buffer->asNewNativeImage();
+                hasAlpha = buffer->hasAlpha();
+            }
+        }
+
+        // The surface keeps the pixels alive, the rest goes away here
+        decoder = nullptr;
+        data = nullptr;
+
+        callOnMainThread([=] {
+            completionHandler(image, hasAlpha);
+        });
+    });
+}
+#endif
+
 bool ImageSource::isSizeAvailable()
 {
     return m_decoder && m_decoder->isSizeAvailable();
@@ -116,12 +207,14 @@ IntSize ImageSource::size(ImageOrientationDescription description) const
     return frameSizeAtIndex(0, 0, description);
 }
 
-IntSize ImageSource::frameSizeAtIndex(size_t index, SubsamplingLevel, ImageOrientationDescription description) const
+IntSize ImageSource::frameSizeAtIndex(size_t index, SubsamplingLevel subsamplingLevel, ImageOrientationDescription description) const
 {
     if (!m_decoder)
         return IntSize();
 
     IntSize size = m_decoder->frameSizeAtIndex(index);
+    if (subsamplingLevel)
+        size = ImageDecoder::subsampledSize(size, subsamplingLevel);
     if ((description.respectImageOrientation() == RespectImageOrientation) && m_decoder->orientation().usesWidthAsHeight())
         return IntSize(size.height(), size.width());
 
@@ -148,11 +241,15 @@ size_t ImageSource::frameCount() const
     return m_decoder ? m_decoder->frameCount() : 0;
 }
 
-PassNativeImagePtr ImageSource::createFrameAtIndex(size_t index, SubsamplingLevel)
+PassNativeImagePtr ImageSource::createFrameAtIndex(size_t index, SubsamplingLevel subsamplingLevel)
 {
     if (!m_decoder)
         return 0;
 
+    if (subsamplingLevel != m_decoder->subsamplingLevel()
+        && (!subsamplingLevel || allowSubsamplingOfFrameAtIndex(index)))
+        setSubsamplingLevel(subsamplingLevel);
+
     ImageFrame* buffer = m_decoder->frameBufferAtIndex(index);
     if (!buffer || buffer->status() == ImageFrame::FrameEmpty)
         return 0;
@@ -207,11 +304,14 @@ bool ImageSource::frameIsCompleteAtIndex(size_t index)
     return buffer && buffer->status() == ImageFrame::FrameComplete;
 }
 
-unsigned ImageSource::frameBytesAtIndex(size_t index, SubsamplingLevel) const
+unsigned ImageSource::frameBytesAtIndex(size_t index, SubsamplingLevel subsamplingLevel) const
 {
     if (!m_decoder)
         return 0;
-    return m_decoder->frameBytesAtIndex(index);
+    unsigned bytes = m_decoder->frameBytesAtIndex(index);
+    if (!bytes || !subsamplingLevel)
+        return bytes;
+    return frameSizeAtIndex(index, subsamplingLevel).area() * sizeof(ImageFrame::PixelData);
 }
 
 }
@@ -34,6 +34,10 @@
 #include <wtf/Noncopyable.h>
 #include <wtf/Vector.h>
 
+#if PLATFORM(FLTK)
+#include <functional>
+#endif
+
 #if USE(CG)
 typedef struct CGImageSource* CGImageSourceRef;
 typedef const struct __CFData* CFDataRef;
@@ -157,12 +161,24 @@ public:
     // decoded then return 0.
     unsigned frameBytesAtIndex(size_t, SubsamplingLevel = 0) const;
 
+#if PLATFORM(FLTK)
+    // Decodes the frame on the image decoding threads, from a copy of the
+    // data, which must be complete. The completion handler runs on the main
+    // thread, with a null image if decoding failed.
+    typedef std::function<void (PassNativeImagePtr, bool hasAlpha)> AsyncFrameHandler;
+    void createFrameAsync(size_t, SubsamplingLevel, AsyncFrameHandler);
+#endif
+
 #if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
     static unsigned maxPixelsPerDecodedImage() { return s_maxPixelsPerDecodedImage; }
     static void setMaxPixelsPerDecodedImage(unsigned maxPixels) { s_maxPixelsPerDecodedImage = maxPixels; }
 #endif
 
 private:
+#if !USE(CG)
+    void setSubsamplingLevel(SubsamplingLevel);
+#endif
+
     NativeImageDecoderPtr m_decoder;
 
 #if !USE(CG)
@@ -55,6 +55,11 @@ BitmapImage::BitmapImage(PassRefPtr<cairo_surface_t> nativeImage, ImageObserver*
     , m_haveSize(true)
     , m_sizeAvailable(true)
     , m_haveFrameCount(true)
+#if PLATFORM(FLTK)
+    , m_asyncDecodePending(false)
+    , m_asyncDecodeFailed(false)
+    , m_weakPtrFactory(this)
+#endif
 {
     m_frames.grow(1);
     m_frames[0].m_hasAlpha = cairo_surface_get_content(nativeImage.get()) != CAIRO_CONTENT_COLOR;
@@ -72,7 +77,21 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst, const Flo
 
     startAnimation();
 
-    RefPtr<cairo_surface_t> surface = frameAtIndex(m_currentFrame);
+    // Decode no larger than drawn
+    const AffineTransform ctm = context->getCTM();
+    const float scale = std::max(dst.width() / src.width(), dst.height() / src.height())
+        * std::max(ctm.xScale(), ctm.yScale());
+
+#if PLATFORM(FLTK)
+    // While decoding in the background, draw the coarser frame if there is one
+    RefPtr<cairo_surface_t> surface;
+    if (decodeFrameAsync(m_currentFrame, scale))
+        surface = m_frames.isEmpty() ? nullptr : m_frames[0].m_frame;
+    else
+        surface = frameAtIndex(m_currentFrame, scale);
+#else
+    RefPtr<cairo_surface_t> surface = frameAtIndex(m_currentFrame, scale);
+#endif
     if (!surface) // If it's too early we won't have an image yet.
         return;
 
@@ -122,9 +141,88 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst, const Flo
         imageObserver()->didDraw(this);
 }
 
+#if PLATFORM(FLTK)
+// Below this many pixels decoding is quicker than the round trip
+static const int minimumAsyncDecodeArea = 256 * 256;
+
+bool BitmapImage::decodeFrameAsync(size_t index, float presentationScaleHint)
+{
+    // Animations composite frames in order, they are decoded as they play
+    if (index || !m_allDataReceived || m_asyncDecodeFailed || frameCount() != 1)
+        return false;
+
+    SubsamplingLevel subsamplingLevel = std::min(m_source.subsamplingLevelForScale(presentationScaleHint), m_minimumSubsamplingLevel);
+    if (!m_frames.isEmpty() && m_frames[0].m_frame && m_frames[0].m_subsamplingLevel <= subsamplingLevel)
+        return false;
+    if (m_asyncDecodePending)
+        return true;
+    if (m_source.frameSizeAtIndex(0, subsamplingLevel).area() < minimumAsyncDecodeArea)
+        return false;
+
+    m_asyncDecodePending = true;
+    WeakPtr<BitmapImage> weakThis = m_weakPtrFactory.createWeakPtr();
+    m_source.createFrameAsync(0, subsamplingLevel, [weakThis, subsamplingLevel](PassNativeImagePtr image, bool hasAlpha) {
+        if (weakThis)
+            weakThis->didDecodeFrameAsync(subsamplingLevel, image, hasAlpha);
+    });
+    return true;
+}
+
+void BitmapImage::didDecodeFrameAsync(SubsamplingLevel subsamplingLevel, PassNativeImagePtr image, bool hasAlpha)
+{
+    m_asyncDecodePending = false;
+
+    RefPtr<cairo_surface_t> surface = image;
+    if (!surface) {
+        // Leave it to the main thread, which knows how to show a broken image
+        m_asyncDecodeFailed = true;
+        if (imageObserver())
+            imageObserver()->animationAdvanced(this);
+        return;
+    }
+    if (frameCount() != 1)
+        return;
+
+    if (m_frames.isEmpty())
+        m_frames.grow(1);
+    FrameData& frame = m_frames[0];
+    if (frame.m_frame && frame.m_subsamplingLevel <= subsamplingLevel)
+        return;
+
+    int deltaBytes = -safeCast<int>(frame.m_frame ? frame.m_frameBytes : 0);
+    if (frame.m_frame) {
+        frame.clear(true);
+        invalidatePlatformData();
+    }
+
+    frame.m_frame = surface.release();
+    frame.m_subsamplingLevel = subsamplingLevel;
+    frame.m_orientation = m_source.orientationAtIndex(0);
+    frame.m_haveMetadata = true;
+    frame.m_isComplete = true;
+    frame.m_hasAlpha = hasAlpha;
+    frame.m_frameBytes = cairoSurfaceSize(frame.m_frame.get()).area() * 4;
+    checkForSolidColor();
+
+    deltaBytes += safeCast<int>(frame.m_frameBytes);
+    m_decodedSize += deltaBytes;
+    deltaBytes -= m_decodedPropertiesSize;
+    m_decodedPropertiesSize = 0;
+
+    if (imageObserver()) {
+        imageObserver()->decodedSizeChanged(this, deltaBytes);
+        // Repaints wherever the image is shown
+        imageObserver()->animationAdvanced(this);
+    }
+}
+#endif
+
+// Subsampling follows the drawn scale, this only caps it
 void BitmapImage::determineMinimumSubsamplingLevel() const
 {
     m_minimumSubsamplingLevel = 0;
+    if (m_allowSubsampling && m_source.allowSubsamplingOfFrameAtIndex(0))
+        m_minimumSubsamplingLevel = 3;
 }
 
 void BitmapImage::checkForSolidColor()
@@ -135,6 +233,12 @@ void BitmapImage::checkForSolidColor()
     if (frameCount() > 1)
         return;
 
+    // Checked first, asking for the frame at full scale would undo any
+    // subsampling
+    const FloatSize imageSize = size();
+    if (imageSize.width() != 1 || imageSize.height() != 1)
+        return;
+
     RefPtr<cairo_surface_t> surface = frameAtIndex(m_currentFrame);
     if (!surface) // If it's too early we won't have an image yet.
         return;
@@ -127,7 +127,8 @@ ImageDecoder* ImageDecoder::create(const SharedBuffer& data, ImageSource::AlphaO
 }
 
 ImageFrame::ImageFrame()
-    : m_hasAlpha(false)
+    : m_bytes(0)
+    , m_hasAlpha(false)
     , m_status(FrameEmpty)
     , m_duration(0)
     , m_disposalMethod(DisposeNotSpecified)
@@ -151,7 +152,7 @@ ImageFrame& ImageFrame::operator=(const ImageFrame& other)
 
 void ImageFrame::clearPixelData()
 {
-    m_backingStore.clear();
+    m_backingStore = nullptr;
     m_bytes = 0;
     m_status = FrameEmpty;
     // NOTE: Do not reset other members here; clearFrameBufferCache() calls this
@@ -188,8 +189,18 @@ bool ImageFrame::copyBitmapData(const ImageFrame& other)
     if (this == &other)
         return true;
 
-    m_backingStore = other.m_backingStore;
-    m_bytes = m_backingStore.data();
+    // The other frame's pixels may be shared with native images already,
+    // and this one is going to be written to.
+    const size_t count = other.m_size.width() * other.m_size.height();
+    m_backingStore = nullptr;
+    m_bytes = 0;
+    if (other.m_bytes) {
+        m_backingStore = ImageFramePixels::tryCreate(count);
+        if (!m_backingStore)
+            return false;
+        memcpy(m_backingStore->data(), other.m_bytes, count * sizeof(PixelData));
+        m_bytes = m_backingStore->data();
+    }
     m_size = other.m_size;
     setHasAlpha(other.m_hasAlpha);
     return true;
@@ -198,11 +209,11 @@ bool ImageFrame::copyBitmapData(const ImageFrame& other)
 bool ImageFrame::setSize(int newWidth, int newHeight)
 {
     ASSERT(!width() && !height());
-    size_t backingStoreSize = newWidth * newHeight;
-    if (!m_backingStore.tryReserveCapacity(backingStoreSize))
+    size_t backingStoreSize = static_cast<size_t>(newWidth) * newHeight;
+    m_backingStore = ImageFramePixels::tryCreate(backingStoreSize);
+    if (!m_backingStore)
         return false;
-    m_backingStore.resize(backingStoreSize);
-    m_bytes = m_backingStore.data();
+    m_bytes = m_backingStore->data();
     m_size = IntSize(newWidth, newHeight);
 
     zeroFillPixelData();
@@ -288,19 +299,29 @@ unsigned ImageDecoder::frameBytesAtIndex(size_t index) const
 }
 
 void ImageDecoder::prepareScaleDataIfNecessary()
+{
+    prepareScaleData(size(), m_subsamplingLevel);
+}
+
+// Picks the rows and columns to keep out of |decodedSize|, for the pixel
+// cap and for subsampling levels the decoder can't do natively. A level
+// keeps every 2^level-th pixel, which gives subsampledSize().
+void ImageDecoder::prepareScaleData(const IntSize& decodedSize, SubsamplingLevel level)
 {
     m_scaled = false;
     m_scaledColumns.clear();
     m_scaledRows.clear();
 
-    int width = size().width();
-    int height = size().height();
+    int width = decodedSize.width();
+    int height = decodedSize.height();
     int numPixels = height * width;
-    if (m_maxNumPixels <= 0 || numPixels <= m_maxNumPixels)
+    double scale = 1.0 / (1 << level);
+    if (m_maxNumPixels > 0 && numPixels * scale * scale > m_maxNumPixels)
+        scale = sqrt(m_maxNumPixels / (double)numPixels);
+    if (scale >= 1)
         return;
 
     m_scaled = true;
-    double scale = sqrt(m_maxNumPixels / (double)numPixels);
     fillScaledValues(m_scaledColumns, scale, width);
     fillScaledValues(m_scaledRows, scale, height);
 }
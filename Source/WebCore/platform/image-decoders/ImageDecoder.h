@@ -33,8 +33,11 @@
 #include "ImageSource.h"
 #include "PlatformScreen.h"
 #include "SharedBuffer.h"
+#include <limits>
 #include <wtf/Assertions.h>
+#include <wtf/FastMalloc.h>
 #include <wtf/RefPtr.h>
+#include <wtf/ThreadSafeRefCounted.h>
 #include <wtf/Vector.h>
 #include <wtf/text/WTFString.h>
 
@@ -49,6 +52,33 @@
 
 namespace WebCore {
 
+    // Pixel storage of an ImageFrame. Native images made from a frame hold
+    // a reference instead of copying the pixels.
+    class ImageFramePixels : public ThreadSafeRefCounted<ImageFramePixels> {
+    public:
+        static PassRefPtr<ImageFramePixels> tryCreate(size_t count)
+        {
+            if (count > std::numeric_limits<size_t>::max() / sizeof(unsigned))
+                return nullptr;
+            void* data;
+            if (!tryFastMalloc(count * sizeof(unsigned)).getValue(data))
+                return nullptr;
+            return adoptRef(new ImageFramePixels(static_cast<unsigned*>(data)));
+        }
+
+        ~ImageFramePixels() { fastFree(m_data); }
+
+        unsigned* data() const { return m_data; }
+
+    private:
+        explicit ImageFramePixels(unsigned* data)
+            : m_data(data)
+        {
+        }
+
+        unsigned* m_data;
+    };
+
     // ImageFrame represents the decoded image data.  This buffer is what all
     // decoders write a single frame into.
     class ImageFrame {
@@ -218,7 +248,7 @@ namespace WebCore {
             return m_size.height();
         }
 
-        Vector<PixelData> m_backingStore;
+        RefPtr<ImageFramePixels> m_backingStore;
         PixelData* m_bytes; // The memory is backed by m_backingStore.
         IntSize m_size;
         // FIXME: Do we need m_colorProfile anymore?
@@ -245,6 +275,7 @@ namespace WebCore {
     public:
         ImageDecoder(ImageSource::AlphaOption alphaOption, ImageSource::GammaAndColorProfileOption gammaAndColorProfileOption)
             : m_scaled(false)
+            , m_subsamplingLevel(0)
             , m_premultiplyAlpha(alphaOption == ImageSource::AlphaPremultiplied)
             , m_ignoreGammaAndColorProfile(gammaAndColorProfileOption == ImageSource::GammaAndColorProfileIgnored)
             , m_sizeAvailable(false)
@@ -262,6 +293,20 @@ namespace WebCore {
         virtual String filenameExtension() const = 0;
 
         bool isAllDataReceived() const { return m_isAllDataReceived; }
+        SharedBuffer* data() const { return m_data.get(); }
+
+        // Decoders that can decode straight to a smaller size. The level
+        // must be set before any data is given to the decoder.
+        virtual bool supportsSubsampling() const { return false; }
+        SubsamplingLevel subsamplingLevel() const { return m_subsamplingLevel; }
+        void setSubsamplingLevel(SubsamplingLevel level) { m_subsamplingLevel = level; }
+
+        // Each level halves both dimensions, rounding up
+        static IntSize subsampledSize(const IntSize& size, SubsamplingLevel level)
+        {
+            const int factor = 1 << level;
+            return IntSize((size.width() + factor - 1) / factor, (size.height() + factor - 1) / factor);
+        }
 
         virtual void setData(SharedBuffer* data, bool allDataReceived)
         {
@@ -405,6 +450,7 @@ namespace WebCore {
 
     protected:
         void prepareScaleDataIfNecessary();
+        void prepareScaleData(const IntSize& decodedSize, SubsamplingLevel);
         int upperBoundScaledX(int origX, int searchStart = 0);
         int lowerBoundScaledX(int origX, int searchStart = 0);
         int upperBoundScaledY(int origY, int searchStart = 0);
@@ -418,6 +464,7 @@ namespace WebCore {
         bool m_scaled;
         Vector<int> m_scaledColumns;
         Vector<int> m_scaledRows;
+        SubsamplingLevel m_subsamplingLevel;
         bool m_premultiplyAlpha;
         bool m_ignoreGammaAndColorProfile;
         ImageOrientation m_orientation;
@@ -30,12 +30,28 @@
 
 namespace WebCore {
 
+static cairo_user_data_key_t pixelsKey;
+
+static void releasePixels(void* pixels)
+{
+    static_cast<ImageFramePixels*>(pixels)->deref();
+}
+
+// The surface wraps the decoded pixels and keeps them alive. A partial
+// frame gets a new surface each time, so cairo never shows a stale copy.
 PassNativeImagePtr ImageFrame::asNewNativeImage() const
 {
-    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width(), height());
-    unsigned char* data = cairo_image_surface_get_data(surface);
-    memcpy(data, m_bytes, width() * height() * sizeof(PixelData));
-    cairo_surface_mark_dirty(surface);
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(reinterpret_cast<unsigned char*>(m_bytes),
+        CAIRO_FORMAT_ARGB32, width(), height(), width() * sizeof(PixelData));
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+        return adoptRef(surface);
+
+    m_backingStore->ref();
+    if (cairo_surface_set_user_data(surface, &pixelsKey, m_backingStore.get(), releasePixels) != CAIRO_STATUS_SUCCESS) {
+        m_backingStore->deref();
+        cairo_surface_destroy(surface);
+        return nullptr;
+    }
     return adoptRef(surface);
 }
 
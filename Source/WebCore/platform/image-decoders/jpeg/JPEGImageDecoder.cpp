@@ -368,6 +368,12 @@ public:
 
             m_decoder->setOrientation(readImageOrientation(info()));
 
+            // Subsampling is done by the IDCT, at 1/2, 1/4 or 1/8 scale.
+            m_info.scale_num = 1;
+            m_info.scale_denom = 1 << m_decoder->subsamplingLevel();
+            jpeg_calc_output_dimensions(&m_info);
+            m_decoder->setOutputSize(m_info.output_width, m_info.output_height);
+
 #if ENABLE(IMAGE_DECODER_DOWN_SAMPLING) && defined(TURBO_JPEG_RGB_SWIZZLE)
             // There's no point swizzle decoding if image down sampling will
             // be applied. Revert to using JSC_RGB in that case.
@@ -606,11 +612,14 @@ bool JPEGImageDecoder::isSizeAvailable()
 
 bool JPEGImageDecoder::setSize(unsigned width, unsigned height)
 {
-    if (!ImageDecoder::setSize(width, height))
-        return false;
+    return ImageDecoder::setSize(width, height);
+}
 
-    prepareScaleDataIfNecessary();
-    return true;
+void JPEGImageDecoder::setOutputSize(unsigned width, unsigned height)
+{
+    // The pixel cap applies on top of what the IDCT produces
+    m_outputSize = IntSize(width, height);
+    prepareScaleData(m_outputSize, 0);
 }
 
 ImageFrame* JPEGImageDecoder::frameBufferAtIndex(size_t index)
@@ -707,7 +716,8 @@ bool JPEGImageDecoder::outputScanlines()
     // Initialize the framebuffer if needed.
     ImageFrame& buffer = m_frameBufferCache[0];
     if (buffer.status() == ImageFrame::FrameEmpty) {
-        if (!buffer.setSize(scaledSize().width(), scaledSize().height()))
+        const IntSize bufferSize = m_scaled ? scaledSize() : m_outputSize;
+        if (!buffer.setSize(bufferSize.width(), bufferSize.height()))
             return setFailed();
         buffer.setStatus(ImageFrame::FramePartial);
         // The buffer is transparent outside the decoded area while the image is
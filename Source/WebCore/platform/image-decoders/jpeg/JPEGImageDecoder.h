@@ -49,6 +49,7 @@ namespace WebCore {
         virtual bool isSizeAvailable();
         virtual bool setSize(unsigned width, unsigned height);
         virtual ImageFrame* frameBufferAtIndex(size_t index);
+        virtual bool supportsSubsampling() const override { return true; }
         // CAUTION: setFailed() deletes |m_reader|.  Be careful to avoid
         // accessing deleted memory, especially when calling this from inside
         // JPEGImageReader!
@@ -60,6 +61,9 @@ namespace WebCore {
             return m_scaled;
         }
 
+        // Size after IDCT scaling, before the pixel cap
+        void setOutputSize(unsigned width, unsigned height);
+
         bool outputScanlines();
         void jpegComplete();
 
@@ -79,6 +83,7 @@ namespace WebCore {
         bool outputScanlines(ImageFrame& buffer);
 
         std::unique_ptr<JPEGImageReader> m_reader;
+        IntSize m_outputSize;
     };
 
 } // namespace WebCore
@@ -179,8 +179,8 @@ void WEBPImageDecoder::applyColorProfile(const uint8_t* data, size_t size, Image
         m_haveReadProfile = true;
     }
 
-    ASSERT(width == scaledSize().width());
-    ASSERT(decodedHeight <= scaledSize().height());
+    ASSERT(width == subsampledSize(size(), m_subsamplingLevel).width());
+    ASSERT(decodedHeight <= subsampledSize(size(), m_subsamplingLevel).height());
 
     for (int y = m_decodedHeight; y < decodedHeight; ++y) {
         uint8_t* row = reinterpret_cast<uint8_t*>(buffer.getAddr(0, y));
@@ -249,8 +249,11 @@ bool WEBPImageDecoder::decode(bool onlySize)
     ImageFrame& buffer = m_frameBufferCache[0];
     ASSERT(buffer.status() != ImageFrame::FrameComplete);
 
+    // libwebp scales while decoding, to the size of the subsampling level
+    const IntSize decodedSize = subsampledSize(size(), m_subsamplingLevel);
+
     if (buffer.status() == ImageFrame::FrameEmpty) {
-        if (!buffer.setSize(size().width(), size().height()))
+        if (!buffer.setSize(decodedSize.width(), decodedSize.height()))
             return setFailed();
         buffer.setStatus(ImageFrame::FramePartial);
         buffer.setHasAlpha(m_hasAlpha);
@@ -263,10 +266,24 @@ bool WEBPImageDecoder::decode(bool onlySize)
             mode = outputMode(false);
         if ((m_formatFlags & ICCP_FLAG) && !ignoresGammaAndColorProfile())
             mode = MODE_RGBA; // Decode to RGBA for input to libqcms.
-        int rowStride = size().width() * sizeof(ImageFrame::PixelData);
+        int rowStride = decodedSize.width() * sizeof(ImageFrame::PixelData);
         uint8_t* output = reinterpret_cast<uint8_t*>(buffer.getAddr(0, 0));
-        int outputSize = size().height() * rowStride;
-        m_decoder = WebPINewRGB(mode, output, outputSize, rowStride);
+        int outputSize = decodedSize.height() * rowStride;
+        if (decodedSize == size())
+            m_decoder = WebPINewRGB(mode, output, outputSize, rowStride);
+        else {
+            if (!WebPInitDecoderConfig(&m_decoderConfig))
+                return setFailed();
+            m_decoderConfig.options.use_scaling = 1;
+            m_decoderConfig.options.scaled_width = decodedSize.width();
+            m_decoderConfig.options.scaled_height = decodedSize.height();
+            m_decoderConfig.output.colorspace = mode;
+            m_decoderConfig.output.is_external_memory = 1;
+            m_decoderConfig.output.u.RGBA.rgba = output;
+            m_decoderConfig.output.u.RGBA.stride = rowStride;
+            m_decoderConfig.output.u.RGBA.size = outputSize;
+            m_decoder = WebPIDecode(0, 0, &m_decoderConfig);
+        }
         if (!m_decoder)
             return setFailed();
     }
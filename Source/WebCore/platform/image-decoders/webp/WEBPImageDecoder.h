@@ -48,11 +48,14 @@ public:
     virtual String filenameExtension() const { return "webp"; }
     virtual bool isSizeAvailable();
     virtual ImageFrame* frameBufferAtIndex(size_t index);
+    virtual bool supportsSubsampling() const override { return true; }
 
 private:
     bool decode(bool onlySize);
 
     WebPIDecoder* m_decoder;
+    // Must outlive m_decoder when scaling, libwebp keeps pointers into it
+    WebPDecoderConfig m_decoderConfig;
     bool m_hasAlpha;
     int m_formatFlags;
 
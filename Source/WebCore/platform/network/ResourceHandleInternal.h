@@ -46,6 +46,7 @@
 #include <curl/curl.h>
 #include "FormDataStreamCurl.h"
 #include "MultipartHandle.h"
+#include <atomic>
 #endif
 
 #if USE(SOUP)
@@ -149,7 +150,9 @@ namespace WebCore {
         char* m_url { nullptr };
         struct curl_slist* m_customHeaders { nullptr };
         ResourceResponse m_response;
-        bool m_cancelled { false };
+        // Read by the network thread's callbacks
+        std::atomic<bool> m_cancelled { false };
+        bool m_threaded { false }; // m_handle belongs to the network thread
         unsigned short m_authFailureCount { 0 };
 
         FormDataStream m_formDataStream;
@@ -158,6 +161,7 @@ namespace WebCore {
 
         std::unique_ptr<MultipartHandle> m_multipartHandle;
         bool m_addedCacheValidationHeaders { false };
+        String m_connectionHost; // counts against this host's connection limit
 #endif
 #if USE(SOUP)
         GRefPtr<SoupMessage> m_soupMessage;
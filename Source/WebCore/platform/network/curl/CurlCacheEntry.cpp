@@ -75,7 +75,8 @@ bool CurlCacheEntry::isLoading() const
     return m_isLoading;
 }
 
-// Cache manager should invalidate the entry on false
+// Cache manager should invalidate the entry on false.
+// Expired entries are kept, every request revalidates them anyway.
 bool CurlCacheEntry::isCached()
 {
     if (!fileExists(m_contentFilename) || !fileExists(m_headerFilename))
@@ -86,17 +87,39 @@ bool CurlCacheEntry::isCached()
             return false;
     }
 
-    if (m_expireDate < currentTimeMS()) {
-        m_headerParsed = false;
-        return false;
-    }
-
     if (!entrySize())
         return false;
 
     return true;
 }
 
+// Checks the content file against Content-Length, a crash while
+// loading leaves a truncated file behind.
+bool CurlCacheEntry::isComplete()
+{
+    if (!m_headerParsed && !loadResponseHeaders())
+        return false;
+
+    // Content is stored decoded, the length is for the encoded body
+    if (!m_cachedResponse.httpHeaderField(HTTPHeaderName::ContentEncoding).isEmpty())
+        return true;
+
+    const String& contentLength = m_cachedResponse.httpHeaderField(HTTPHeaderName::ContentLength);
+    if (contentLength.isEmpty())
+        return true;
+
+    bool ok;
+    long long expectedSize = contentLength.toInt64Strict(&ok);
+    if (!ok)
+        return true;
+
+    long long fileSize;
+    if (!getFileSize(m_contentFilename, fileSize))
+        return false;
+
+    return fileSize == expectedSize;
+}
+
 bool CurlCacheEntry::saveCachedData(const char* data, size_t size)
 {
     if (!openContentFile())
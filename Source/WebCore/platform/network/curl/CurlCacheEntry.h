@@ -47,6 +47,7 @@ public:
     ~CurlCacheEntry();
 
     bool isCached();
+    bool isComplete();
     bool isLoading() const;
     size_t entrySize();
     HTTPHeaderMap& requestHeaders() { return m_requestHeaders; }
@@ -70,6 +71,7 @@ public:
     int hasClients() const { return m_clients.size() > 0; }
 
     const ResourceHandle* getJob() const { return m_job; }
+    const String& basename() const { return m_basename; }
 
 private:
     String m_basename;
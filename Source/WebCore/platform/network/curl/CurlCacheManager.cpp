@@ -37,10 +37,16 @@
 #include "ResourceHandleInternal.h"
 #include "ResourceRequest.h"
 #include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
 #include <wtf/text/CString.h>
 
 #define IO_BUFFERSIZE 4096
 
+// index.dat is a journal: "+url" adds or refreshes an entry, "-url" drops it.
+// Lines are appended as the cache changes and the file is rewritten in LRU
+// order on startup, exit and when it grows too long, so a crash loses at
+// most the entries that were still loading.
+
 namespace WebCore {
 
 CurlCacheManager& CurlCacheManager::getInstance()
@@ -53,6 +59,8 @@ CurlCacheManager::CurlCacheManager()
     : m_disabled(true)
     , m_currentStorageSize(0)
     , m_storageSizeLimit(52428800) // 50 * 1024 * 1024 bytes
+    , m_indexJournal(invalidPlatformFileHandle)
+    , m_indexJournalLines(0)
 {
     // Call setCacheDirectory() to enable the Cache Manager
 }
@@ -63,10 +71,18 @@ CurlCacheManager::~CurlCacheManager()
         return;
 
     saveIndex();
+    closeFile(m_indexJournal);
 }
 
 void CurlCacheManager::setCacheDirectory(const String& directory)
 {
+    // Entries still loading or being read write to the old directory, and
+    // clearing the index under them would free them mid-transfer
+    if (!m_disabled) {
+        LOG(Network, "Cache Error: Cache location is already set! Ignoring the new one.\n");
+        return;
+    }
+
     m_cacheDir = directory;
 
     if (m_cacheDir.isEmpty()) {
@@ -87,11 +103,14 @@ void CurlCacheManager::setCacheDirectory(const String& directory)
 
     m_disabled = false;
     loadIndex();
+    removeOrphanFiles();
+    saveIndex();
 }
 
 void CurlCacheManager::setStorageSizeLimit(size_t sizeLimit)
 {
     m_storageSizeLimit = sizeLimit;
+    makeRoomForNewEntry();
 }
 
 void CurlCacheManager::loadIndex()
@@ -134,24 +153,52 @@ void CurlCacheManager::loadIndex()
     headerContent.split('\n', indexURLs);
     buffer.clear();
 
+    // Replay the journal, oldest first. A line without a trailing newline
+    // was cut short by a crash. Plain URLs come from the old index format.
+    ListHashSet<String> replayed;
+    size_t lines = indexURLs.size();
+    if (lines && !headerContent.endsWith('\n'))
+        --lines;
+    for (size_t i = 0; i < lines; ++i) {
+        String line = indexURLs[i].stripWhiteSpace();
+        if (line.isEmpty())
+            continue;
+        if (line[0] == '-')
+            replayed.remove(line.substring(1));
+        else if (line[0] == '+')
+            replayed.appendOrMoveToLast(line.substring(1));
+        else
+            replayed.prependOrMoveToFirst(line);
+    }
+
     // Add entries to index
-    Vector<String>::const_iterator it = indexURLs.begin();
-    Vector<String>::const_iterator end = indexURLs.end();
-    if (indexURLs.size() > 1)
-        --end; // Last line is empty
-    while (it != end) {
-        String url = it->stripWhiteSpace();
+    for (const auto& url : replayed) {
         auto cacheEntry = std::make_unique<CurlCacheEntry>(url, nullptr, m_cacheDir);
 
-        if (cacheEntry->isCached() && cacheEntry->entrySize() < m_storageSizeLimit) {
+        if (cacheEntry->isCached() && cacheEntry->isComplete() && cacheEntry->entrySize() < m_storageSizeLimit) {
             m_currentStorageSize += cacheEntry->entrySize();
-            makeRoomForNewEntry();
             m_LRUEntryList.prependOrMoveToFirst(url);
             m_index.set(url, WTF::move(cacheEntry));
+            makeRoomForNewEntry();
         } else
             cacheEntry->invalidate();
+    }
+}
 
-        ++it;
+// Drops files no index entry refers to, left over from crashes.
+void CurlCacheManager::removeOrphanFiles()
+{
+    HashSet<String> known;
+    for (const auto& entry : m_index.values())
+        known.add(entry->basename());
+
+    const char* patterns[] = { "*.header", "*.content" };
+    for (const char* pattern : patterns) {
+        for (const auto& path : listDirectory(m_cacheDir, pattern)) {
+            String name = pathGetFileName(path);
+            if (!known.contains(name.left(name.reverseFind('.'))))
+                deleteFile(path);
+        }
     }
 }
 
@@ -162,24 +209,58 @@ void CurlCacheManager::saveIndex()
 
     String indexFilePath(m_cacheDir);
     indexFilePath.append("index.dat");
+    String tempFilePath(indexFilePath);
+    tempFilePath.append(".tmp");
+
+    closeFile(m_indexJournal);
+    m_indexJournalLines = 0;
 
-    deleteFile(indexFilePath);
-    PlatformFileHandle indexFile = openFile(indexFilePath, OpenForWrite);
+    // Write a fresh copy aside and rename it over the old one, the
+    // index on disk is always complete.
+    PlatformFileHandle indexFile = openFile(tempFilePath, OpenForWrite);
     if (!isHandleValid(indexFile)) {
-        LOG(Network, "Cache Error: Could not open %s for write\n", indexFilePath.latin1().data());
+        LOG(Network, "Cache Error: Could not open %s for write\n", tempFilePath.latin1().data());
         return;
     }
 
-    auto it = m_LRUEntryList.begin();
-    const auto& end = m_LRUEntryList.end();
-    while (it != end) {
-        const CString& urlLatin1 = it->latin1();
-        writeToFile(indexFile, urlLatin1.data(), urlLatin1.length());
-        writeToFile(indexFile, "\n", 1);
-        ++it;
-    }
+    bool success = true;
+    for (auto it = m_LRUEntryList.rbegin(); it != m_LRUEntryList.rend(); ++it) {
+        auto entry = m_index.find(*it);
+        if (entry == m_index.end() || entry->value->isLoading())
+            continue;
 
+        CString line = String("+" + *it + "\n").latin1();
+        if (writeToFile(indexFile, line.data(), line.length()) != static_cast<int>(line.length())) {
+            success = false;
+            break;
+        }
+        m_indexJournalLines++;
+    }
     closeFile(indexFile);
+
+    if (!success || !moveFile(tempFilePath, indexFilePath)) {
+        LOG(Network, "Cache Error: Could not write %s\n", indexFilePath.latin1().data());
+        deleteFile(tempFilePath);
+        return;
+    }
+
+    m_indexJournal = openFile(indexFilePath, OpenForAppend);
+}
+
+void CurlCacheManager::appendToIndex(char op, const String& url)
+{
+    if (!isHandleValid(m_indexJournal))
+        return;
+
+    // Compact once most of the journal is stale
+    if (m_indexJournalLines > 2 * m_index.size() + 1024) {
+        saveIndex();
+        return;
+    }
+
+    CString line = String(String(&op, 1) + url + "\n").latin1();
+    writeToFile(m_indexJournal, line.data(), line.length());
+    m_indexJournalLines++;
 }
 
 void CurlCacheManager::makeRoomForNewEntry()
@@ -237,8 +318,10 @@ void CurlCacheManager::didFinishLoading(ResourceHandle& job)
     const String& url = job.firstRequest().url().string();
 
     auto it = m_index.find(url);
-    if (it != m_index.end())
+    if (it != m_index.end() && it->value->isLoading()) {
         it->value->didFinishLoading();
+        appendToIndex('+', url);
+    }
 }
 
 bool CurlCacheManager::isCached(const String& url) const
@@ -315,8 +398,11 @@ void CurlCacheManager::invalidateCacheEntry(const String& url)
         else
             m_currentStorageSize -= it->value->entrySize();
 
+        bool journaled = !it->value->isLoading();
         it->value->invalidate();
         m_index.remove(url);
+        if (journaled)
+            appendToIndex('-', url);
     }
     m_LRUEntryList.remove(url);
 }
@@ -359,6 +445,8 @@ void CurlCacheManager::readCachedData(const String& url, ResourceHandle* job, Re
         m_LRUEntryList.prependOrMoveToFirst(url);
         if (!it->value->readCachedData(job))
             invalidateCacheEntry(url);
+        else
+            appendToIndex('+', url);
     }
 }
 
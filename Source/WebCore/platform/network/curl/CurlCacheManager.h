@@ -41,6 +41,7 @@ class CurlCacheManager {
 public:
     static CurlCacheManager& getInstance();
 
+    // Enables the cache. Once it is on, later calls are ignored.
     void setCacheDirectory(const String&);
     const String& cacheDirectory() { return m_cacheDir; }
     void setStorageSizeLimit(size_t);
@@ -71,8 +72,13 @@ private:
     size_t m_currentStorageSize;
     size_t m_storageSizeLimit;
 
+    PlatformFileHandle m_indexJournal;
+    size_t m_indexJournalLines;
+
     void saveIndex();
     void loadIndex();
+    void appendToIndex(char op, const String& url);
+    void removeOrphanFiles();
     void makeRoomForNewEntry();
 
     void saveResponseHeaders(const String&, ResourceResponse&);
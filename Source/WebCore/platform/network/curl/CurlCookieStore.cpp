@@ -0,0 +1,514 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#if USE(CURL)
+
+#include "CurlCookieStore.h"
+
+#include "Logging.h"
+#include "PublicSuffix.h"
+#include <algorithm>
+#include <cmath>
+#include <wtf/DateMath.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringBuilder.h>
+
+namespace WebCore {
+
+CurlCookieStore::CurlCookieStore(const char* fileName, CURLSH* curlsh)
+    : m_cookieCount(0)
+    , m_fileName(fileName)
+    , m_journal(invalidPlatformFileHandle)
+    , m_journalLines(0)
+{
+    m_curlHandle = curl_easy_init();
+    curl_easy_setopt(m_curlHandle, CURLOPT_SHARE, curlsh);
+    // An empty name turns on the cookie engine without reading anything
+    curl_easy_setopt(m_curlHandle, CURLOPT_COOKIEFILE, "");
+
+    load();
+}
+
+CurlCookieStore::~CurlCookieStore()
+{
+    save();
+    closeFile(m_journal);
+    curl_easy_cleanup(m_curlHandle);
+}
+
+static bool pathMatches(const String& cookiePath, const String& path)
+{
+    if (path == cookiePath)
+        return true;
+
+    if (!path.startsWith(cookiePath))
+        return false;
+
+    return cookiePath.endsWith('/') || path[cookiePath.length()] == '/';
+}
+
+static String defaultPath(const URL& url)
+{
+    String path = url.path();
+    size_t lastSlash = path.reverseFind('/');
+    if (!lastSlash || lastSlash == notFound)
+        return "/";
+    return path.left(lastSlash);
+}
+
+// Without the list, ports only get the check against top level domains
+static bool isPublicSuffixDomain(const String& domain)
+{
+#if ENABLE(PUBLIC_SUFFIX_LIST)
+    return isPublicSuffix(domain);
+#else
+    UNUSED_PARAM(domain);
+    return false;
+#endif
+}
+
+bool CurlCookieStore::parseSetCookie(const URL& url, const String& header, StoredCookie& cookie) const
+{
+    Vector<String> attributes;
+    header.split(';', false, attributes);
+
+    if (!attributes.size())
+        return false;
+
+    // First attribute should be <cookiename>=<cookievalue>
+    size_t equals = attributes[0].find('=');
+    if (equals != notFound) {
+        cookie.name = attributes[0].left(equals).stripWhiteSpace();
+        cookie.value = attributes[0].substring(equals + 1).stripWhiteSpace();
+    } else {
+        // According to RFC6265 we should ignore the entire
+        // set-cookie string now, but other browsers appear
+        // to treat this as <cookiename>=<empty>
+        cookie.name = attributes[0].stripWhiteSpace();
+    }
+
+    if (cookie.name.isEmpty() && cookie.value.isEmpty())
+        return false;
+
+    const String host = url.host().lower();
+    cookie.domain = host;
+    cookie.path = defaultPath(url);
+    cookie.expires = 0;
+    cookie.hostOnly = true;
+    cookie.secure = false;
+    cookie.httpOnly = false;
+
+    bool hasMaxAge = false;
+
+    // Iterate through remaining attributes
+    for (size_t i = 1; i < attributes.size(); ++i) {
+        const String& attribute = attributes[i];
+        equals = attribute.find('=');
+        String key = attribute.left(equals).stripWhiteSpace().lower();
+        String value = equals == notFound ? String() : attribute.substring(equals + 1).stripWhiteSpace();
+
+        if (key == "expires" && !hasMaxAge) {
+            double ms = WTF::parseDateFromNullTerminatedCharacters(value.utf8().data());
+            if (std::isnan(ms))
+                continue;
+            cookie.expires = ms > WTF::msPerSecond ? ms / WTF::msPerSecond : 1;
+        } else if (key == "max-age") {
+            bool ok;
+            int seconds = value.toIntStrict(&ok);
+            if (!ok)
+                continue;
+            hasMaxAge = true;
+            cookie.expires = seconds > 0 ? time(0) + seconds : 1;
+        } else if (key == "domain") {
+            String domain = value.lower();
+            if (domain.startsWith('.'))
+                domain.remove(0, 1);
+            if (domain.isEmpty())
+                continue;
+            // Must be the host itself or one of its parents, and not a TLD
+            if (domain != host && (!domain.contains('.') || !host.endsWith(String("." + domain))))
+                return false;
+            // Nor a public suffix like co.uk, shared by unrelated sites.
+            // One that is the host itself only gets a host-only cookie.
+            if (isPublicSuffixDomain(domain)) {
+                if (domain != host)
+                    return false;
+                continue;
+            }
+            cookie.domain = domain;
+            cookie.hostOnly = false;
+        } else if (key == "path") {
+            if (value.startsWith('/'))
+                cookie.path = value;
+        } else if (key == "secure")
+            cookie.secure = true;
+        else if (key == "httponly")
+            cookie.httpOnly = true;
+    }
+
+    return true;
+}
+
+// Description of the Netscape cookie file format which Curl uses:
+//
+// .netscape.com     TRUE   /  FALSE  946684799   NETSCAPE_ID  100103
+//
+// domain, whether subdomains match, path, secure, expiry as UNIX time,
+// name and value, separated by tabs. HttpOnly cookies have the domain
+// prefixed with "#HttpOnly_".
+bool CurlCookieStore::parseNetscapeLine(const String& line, StoredCookie& cookie)
+{
+    String data = line;
+    cookie.httpOnly = data.startsWith("#HttpOnly_");
+    if (cookie.httpOnly)
+        data.remove(0, 10);
+    else if (data.startsWith('#'))
+        return false;
+
+    Vector<String> fields;
+    data.split('\t', true, fields);
+    if (fields.size() != 7)
+        return false;
+
+    cookie.domain = fields[0].lower();
+    if (cookie.domain.startsWith('.'))
+        cookie.domain.remove(0, 1);
+    cookie.hostOnly = fields[1] != "TRUE";
+    cookie.path = fields[2];
+    cookie.secure = fields[3] == "TRUE";
+    cookie.expires = fields[4].toInt64();
+    cookie.name = fields[5];
+    cookie.value = fields[6];
+
+    return !cookie.domain.isEmpty();
+}
+
+CString CurlCookieStore::netscapeLine(const StoredCookie& cookie)
+{
+    StringBuilder line;
+    if (cookie.httpOnly)
+        line.appendLiteral("#HttpOnly_");
+    if (!cookie.hostOnly)
+        line.append('.');
+    line.append(cookie.domain);
+    line.append(cookie.hostOnly ? "\tFALSE\t" : "\tTRUE\t");
+    line.append(cookie.path);
+    line.append(cookie.secure ? "\tTRUE\t" : "\tFALSE\t");
+    line.appendNumber(static_cast<long long>(cookie.expires));
+    line.append('\t');
+    line.append(cookie.name);
+    line.append('\t');
+    line.append(cookie.value);
+
+    return line.toString().utf8();
+}
+
+void CurlCookieStore::store(const StoredCookie& cookie, bool fromDOM)
+{
+    CookieList& list = m_cookies.add(cookie.domain, CookieList()).iterator->value;
+
+    size_t index = notFound;
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i].name == cookie.name && list[i].path == cookie.path) {
+            index = i;
+            break;
+        }
+    }
+
+    // Scripts may not touch HttpOnly cookies
+    bool rejected = fromDOM && (cookie.httpOnly || (index != notFound && list[index].httpOnly));
+
+    if (rejected || (cookie.expires && cookie.expires <= time(0))) {
+        if (index != notFound && !rejected)
+            remove(list, index, fromDOM);
+        if (list.isEmpty())
+            m_cookies.remove(cookie.domain);
+        return;
+    }
+
+    bool wasPersistent = false;
+    if (index != notFound) {
+        wasPersistent = list[index].expires;
+        list[index] = cookie;
+    } else {
+        list.append(cookie);
+        m_cookieCount++;
+    }
+
+    if (fromDOM)
+        curl_easy_setopt(m_curlHandle, CURLOPT_COOKIELIST, netscapeLine(cookie).data());
+
+    if (cookie.expires)
+        persist(cookie);
+    else if (wasPersistent) {
+        StoredCookie expired = cookie;
+        expired.expires = 1;
+        persist(expired);
+    }
+}
+
+void CurlCookieStore::remove(CookieList& list, size_t index, bool pushToCurl)
+{
+    StoredCookie expired = list[index];
+    list.remove(index);
+    m_cookieCount--;
+
+    bool wasPersistent = expired.expires;
+    expired.expires = 1;
+
+    // Curl replaces its copy with the expired one and drops it
+    if (pushToCurl)
+        curl_easy_setopt(m_curlHandle, CURLOPT_COOKIELIST, netscapeLine(expired).data());
+    if (wasPersistent)
+        persist(expired);
+}
+
+// Calls functor for each cookie that applies to url. Cookies it returns true
+// for are deleted.
+template<typename Functor>
+void CurlCookieStore::forEachMatch(const URL& url, const Functor& functor)
+{
+    const String host = url.host().lower();
+    const String path = url.path().isEmpty() ? String("/") : url.path();
+    const bool secure = url.protocolIs("https");
+    const time_t now = time(0);
+
+    // Only the buckets of the host and its parent domains can match
+    for (size_t start = 0; start != notFound && start < host.length(); ) {
+        auto it = m_cookies.find(host.substring(start));
+        if (it != m_cookies.end()) {
+            CookieList& list = it->value;
+            for (size_t i = 0; i < list.size(); ) {
+                const StoredCookie& cookie = list[i];
+                if (cookie.expires && cookie.expires <= now) {
+                    // The file and curl drop expired cookies on their own
+                    list.remove(i);
+                    m_cookieCount--;
+                    continue;
+                }
+
+                if ((!cookie.hostOnly || !start) && (!cookie.secure || secure)
+                    && pathMatches(cookie.path, path) && functor(cookie)) {
+                    remove(list, i, true);
+                    continue;
+                }
+                ++i;
+            }
+            if (list.isEmpty())
+                m_cookies.remove(it);
+        }
+
+        start = host.find('.', start);
+        if (start != notFound)
+            start++;
+    }
+}
+
+void CurlCookieStore::didReceiveSetCookie(const URL& url, const String& header)
+{
+    StoredCookie cookie;
+    if (parseSetCookie(url, header, cookie))
+        store(cookie, false);
+}
+
+void CurlCookieStore::setCookieFromDOM(const URL& url, const String& value)
+{
+    StoredCookie cookie;
+    if (parseSetCookie(url, value, cookie))
+        store(cookie, true);
+}
+
+String CurlCookieStore::cookiesForURL(const URL& url, bool includeHttpOnly)
+{
+    Vector<StoredCookie> matches;
+    forEachMatch(url, [&](const StoredCookie& cookie) {
+        if (includeHttpOnly || !cookie.httpOnly)
+            matches.append(cookie);
+        return false;
+    });
+
+    // Longer paths first, as RFC6265 asks
+    std::stable_sort(matches.begin(), matches.end(), [](const StoredCookie& a, const StoredCookie& b) {
+        return a.path.length() > b.path.length();
+    });
+
+    StringBuilder cookies;
+    for (const auto& cookie : matches) {
+        if (!cookies.isEmpty())
+            cookies.appendLiteral("; ");
+        cookies.append(cookie.name);
+        cookies.append('=');
+        cookies.append(cookie.value);
+    }
+
+    return cookies.toString();
+}
+
+void CurlCookieStore::getRawCookies(const URL& url, Vector<Cookie>& rawCookies)
+{
+    rawCookies.clear();
+    forEachMatch(url, [&](const StoredCookie& cookie) {
+        String domain = cookie.hostOnly ? cookie.domain : String("." + cookie.domain);
+        rawCookies.append(Cookie(cookie.name, cookie.value, domain, cookie.path, cookie.expires * WTF::msPerSecond, cookie.httpOnly, cookie.secure, !cookie.expires));
+        return false;
+    });
+}
+
+void CurlCookieStore::deleteCookie(const URL& url, const String& name)
+{
+    forEachMatch(url, [&](const StoredCookie& cookie) {
+        return cookie.name == name;
+    });
+}
+
+void CurlCookieStore::getHostnames(HashSet<String>& hostnames)
+{
+    for (const auto& domain : m_cookies.keys())
+        hostnames.add(domain);
+}
+
+void CurlCookieStore::deleteCookiesForHostname(const String& hostname)
+{
+    auto it = m_cookies.find(hostname.lower());
+    if (it == m_cookies.end())
+        return;
+
+    CookieList& list = it->value;
+    while (!list.isEmpty())
+        remove(list, list.size() - 1, true);
+    m_cookies.remove(it);
+}
+
+void CurlCookieStore::deleteAllCookies()
+{
+    m_cookies.clear();
+    m_cookieCount = 0;
+
+    curl_easy_setopt(m_curlHandle, CURLOPT_COOKIELIST, "ALL");
+    save();
+}
+
+void CurlCookieStore::load()
+{
+    if (m_fileName.isNull())
+        return;
+
+    String fileName = String::fromUTF8(m_fileName.data());
+    long long fileSize;
+    PlatformFileHandle file = openFile(fileName, OpenForRead);
+    if (isHandleValid(file) && getFileSize(fileName, fileSize)) {
+        Vector<char> buffer(fileSize);
+        int read = readFromFile(file, buffer.data(), fileSize);
+        closeFile(file);
+
+        // A line without a newline was cut short by a crash
+        if (read > 0) {
+            size_t end = read;
+            while (end && buffer[end - 1] != '\n')
+                --end;
+
+            Vector<String> lines;
+            String::fromUTF8(buffer.data(), end).split('\n', lines);
+
+            // Later lines replace earlier ones. Session cookies
+            // from the previous run are not restored, nor ones for a
+            // public suffix stored before those were refused.
+            for (const auto& line : lines) {
+                StoredCookie cookie;
+                if (parseNetscapeLine(line.stripWhiteSpace(), cookie) && cookie.expires
+                    && (cookie.hostOnly || !isPublicSuffixDomain(cookie.domain)))
+                    store(cookie, false);
+            }
+        }
+    } else
+        closeFile(file);
+
+    // Rewrite the journal without the replaced and expired lines, then
+    // let curl read the result.
+    save();
+
+    curl_easy_setopt(m_curlHandle, CURLOPT_COOKIEFILE, m_fileName.data());
+    curl_easy_setopt(m_curlHandle, CURLOPT_COOKIELIST, "RELOAD");
+}
+
+void CurlCookieStore::save()
+{
+    if (m_fileName.isNull())
+        return;
+
+    closeFile(m_journal);
+    m_journalLines = 0;
+
+    String fileName = String::fromUTF8(m_fileName.data());
+    String tempFileName = fileName + ".tmp";
+
+    PlatformFileHandle file = openFile(tempFileName, OpenForWrite);
+    if (!isHandleValid(file)) {
+        LOG(Network, "Cookie Error: Could not open %s for write\n", tempFileName.utf8().data());
+        return;
+    }
+
+    static const char header[] = "# Netscape HTTP Cookie File\n";
+    bool success = writeToFile(file, header, sizeof(header) - 1) == sizeof(header) - 1;
+
+    const time_t now = time(0);
+    for (auto it = m_cookies.begin(); success && it != m_cookies.end(); ++it) {
+        for (const auto& cookie : it->value) {
+            if (!cookie.expires || cookie.expires <= now)
+                continue;
+
+            CString line = netscapeLine(cookie);
+            if (writeToFile(file, line.data(), line.length()) != static_cast<int>(line.length())
+                || writeToFile(file, "\n", 1) != 1) {
+                success = false;
+                break;
+            }
+            m_journalLines++;
+        }
+    }
+    closeFile(file);
+
+    if (!success || !moveFile(tempFileName, fileName)) {
+        LOG(Network, "Cookie Error: Could not write %s\n", fileName.utf8().data());
+        deleteFile(tempFileName);
+        return;
+    }
+
+    m_journal = openFile(fileName, OpenForAppend);
+}
+
+void CurlCookieStore::persist(const StoredCookie& cookie)
+{
+    if (!isHandleValid(m_journal))
+        return;
+
+    // Compact once most of the journal is stale
+    if (m_journalLines > 2 * m_cookieCount + 1024) {
+        save();
+        return;
+    }
+
+    CString line = netscapeLine(cookie);
+    writeToFile(m_journal, line.data(), line.length());
+    writeToFile(m_journal, "\n", 1);
+    m_journalLines++;
+}
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CurlCookieStore_h
+#define CurlCookieStore_h
+
+#include "Cookie.h"
+#include "FileSystem.h"
+#include "URL.h"
+
+#include <curl/curl.h>
+#include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
+#include <wtf/Vector.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringHash.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// Cookies indexed by domain, so a lookup only touches the buckets for the
+// host and its parent domains instead of curl's whole cookie list.
+//
+// Curl keeps its own copy in the share handle for the requests it makes;
+// Set-Cookie headers reach both, DOM changes are pushed to curl from here.
+// The cookie file is a Netscape format journal: changes are appended, and
+// deleted cookies are written back as expired.
+class CurlCookieStore {
+    WTF_MAKE_NONCOPYABLE(CurlCookieStore);
+public:
+    CurlCookieStore(const char* fileName, CURLSH*);
+    ~CurlCookieStore();
+
+    // Set-Cookie header from a response, curl has already stored it
+    void didReceiveSetCookie(const URL&, const String& header);
+    void setCookieFromDOM(const URL&, const String& value);
+
+    String cookiesForURL(const URL&, bool includeHttpOnly);
+    void getRawCookies(const URL&, Vector<Cookie>&);
+
+    void deleteCookie(const URL&, const String& name);
+    void getHostnames(HashSet<String>&);
+    void deleteCookiesForHostname(const String&);
+    void deleteAllCookies();
+
+private:
+    struct StoredCookie {
+        String name;
+        String value;
+        String domain; // lowercase, without the leading dot
+        String path;
+        time_t expires; // 0 for session cookies
+        bool hostOnly;
+        bool secure;
+        bool httpOnly;
+    };
+
+    typedef Vector<StoredCookie> CookieList;
+
+    bool parseSetCookie(const URL&, const String&, StoredCookie&) const;
+    static bool parseNetscapeLine(const String&, StoredCookie&);
+    static CString netscapeLine(const StoredCookie&);
+
+    void store(const StoredCookie&, bool fromDOM);
+    void remove(CookieList&, size_t index, bool pushToCurl);
+    template<typename Functor> void forEachMatch(const URL&, const Functor&);
+
+    void load();
+    void save();
+    void persist(const StoredCookie&);
+
+    HashMap<String, CookieList> m_cookies;
+    size_t m_cookieCount;
+
+    CString m_fileName;
+    PlatformFileHandle m_journal;
+    size_t m_journalLines;
+
+    CURL* m_curlHandle;
+};
+
+}
+
+#endif // CurlCookieStore_h
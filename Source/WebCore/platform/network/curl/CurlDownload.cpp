@@ -40,6 +40,7 @@
 using namespace WebCore;
 
 #if OS(LINUX)
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
@@ -54,6 +55,14 @@ CurlDownloadManager::CurlDownloadManager()
 {
     curl_global_init(CURL_GLOBAL_ALL);
     m_curlMultiHandle = curl_multi_init();
+
+    if (pipe(m_wakeup) == -1) {
+        perror("pipe");
+        m_wakeup[0] = m_wakeup[1] = -1;
+        return;
+    }
+    fcntl(m_wakeup[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_wakeup[1], F_SETFL, O_NONBLOCK);
 }
 
 CurlDownloadManager::~CurlDownloadManager()
@@ -61,6 +70,11 @@ CurlDownloadManager::~CurlDownloadManager()
     stopThread();
     curl_multi_cleanup(m_curlMultiHandle);
     curl_global_cleanup();
+
+    if (m_wakeup[0] >= 0) {
+        close(m_wakeup[0]);
+        close(m_wakeup[1]);
+    }
 }
 
 bool CurlDownloadManager::add(CURL* curlHandle)
@@ -69,6 +83,7 @@ bool CurlDownloadManager::add(CURL* curlHandle)
 
     m_pendingHandleList.append(curlHandle);
     startThreadIfNeeded();
+    wakeThread();
 
     return true;
 }
@@ -78,6 +93,7 @@ bool CurlDownloadManager::remove(CURL* curlHandle)
     MutexLocker locker(m_mutex);
 
     m_removedHandleList.append(curlHandle);
+    wakeThread();
 
     return true;
 }
@@ -117,6 +133,7 @@ void CurlDownloadManager::startThreadIfNeeded()
 void CurlDownloadManager::stopThread()
 {
     m_runThread = false;
+    wakeThread();
 
     if (m_threadId) {
         waitForThreadCompletion(m_threadId);
@@ -132,6 +149,13 @@ void CurlDownloadManager::stopThreadIfIdle()
         setRunThread(false);
 }
 
+void CurlDownloadManager::wakeThread()
+{
+    // A full pipe means a wakeup is pending already.
+    char c = 0;
+    write(m_wakeup[1], &c, 1);
+}
+
 void CurlDownloadManager::updateHandleList()
 {
     MutexLocker locker(m_mutex);
@@ -177,6 +201,8 @@ bool CurlDownloadManager::removeFromCurl(CURL* curlHandle)
     return false;
 }
 
+// Sleeps in curl_multi_wait until a transfer has something to do or the
+// wakeup pipe says the handle lists changed, idle downloads cost nothing.
 void CurlDownloadManager::downloadThread(void* data)
 {
     CurlDownloadManager* downloadManager = reinterpret_cast<CurlDownloadManager*>(data);
@@ -185,47 +211,21 @@ void CurlDownloadManager::downloadThread(void* data)
 
         downloadManager->updateHandleList();
 
-        // Retry 'select' if it was interrupted by a process signal.
-        int rc = 0;
-        do {
-            fd_set fdread;
-            fd_set fdwrite;
-            fd_set fdexcep;
-
-            int maxfd = 0;
-
-            const int selectTimeoutMS = 5;
-
-            struct timeval timeout;
-            timeout.tv_sec = 0;
-            timeout.tv_usec = selectTimeoutMS * 1000; // select waits microseconds
-
-            FD_ZERO(&fdread);
-            FD_ZERO(&fdwrite);
-            FD_ZERO(&fdexcep);
-            curl_multi_fdset(downloadManager->getMultiHandle(), &fdread, &fdwrite, &fdexcep, &maxfd);
-            // When the 3 file descriptors are empty, winsock will return -1
-            // and bail out, stopping the file download. So make sure we
-            // have valid file descriptors before calling select.
-            if (maxfd >= 0)
-                rc = ::select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-        } while (rc == -1 && errno == EINTR);
-
         int activeDownloadCount = 0;
-        while (curl_multi_perform(downloadManager->getMultiHandle(), &activeDownloadCount) == CURLM_CALL_MULTI_PERFORM) { }
-
-        int messagesInQueue = 0;
-        CURLMsg* msg = curl_multi_info_read(downloadManager->getMultiHandle(), &messagesInQueue);
+        curl_multi_perform(downloadManager->getMultiHandle(), &activeDownloadCount);
 
-        if (!msg) {
-            downloadManager->stopThreadIfIdle();
-            continue;
-        }
+        // Everything that finished this round
+        while (true) {
+            int messagesInQueue = 0;
+            CURLMsg* msg = curl_multi_info_read(downloadManager->getMultiHandle(), &messagesInQueue);
+            if (!msg)
+                break;
+            if (msg->msg != CURLMSG_DONE)
+                continue;
 
-        CurlDownload* download = 0;
-        CURLcode err = curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &download);
+            CurlDownload* download = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &download);
 
-        if (msg->msg == CURLMSG_DONE) {
             if (msg->data.result == CURLE_OK)
                 callOnMainThread([download] {
                     if (download)
@@ -237,10 +237,24 @@ void CurlDownloadManager::downloadThread(void* data)
                         download->didFail();
                 });
 
+            MutexLocker locker(downloadManager->m_mutex);
             downloadManager->removeFromCurl(msg->easy_handle);
         }
 
         downloadManager->stopThreadIfIdle();
+        if (!downloadManager->runThread())
+            break;
+
+        struct curl_waitfd wakeup;
+        wakeup.fd = downloadManager->m_wakeup[0];
+        wakeup.events = CURL_WAIT_POLLIN;
+        wakeup.revents = 0;
+        curl_multi_wait(downloadManager->getMultiHandle(), &wakeup, 1, 1000, 0);
+
+        if (wakeup.revents) {
+            char buf[64];
+            while (read(downloadManager->m_wakeup[0], buf, sizeof(buf)) > 0) { }
+        }
     }
 }
 
@@ -253,6 +267,11 @@ CurlDownload::CurlDownload()
 , m_customHeaders(0)
 , m_url(0)
 , m_tempHandle(invalidPlatformFileHandle)
+, m_outputHandle(invalidPlatformFileHandle)
+, m_outputOffset(0)
+, m_rangeStart(0)
+, m_responseAccepted(false)
+, m_emptyRange(false)
 , m_deletesFileUponFailure(false)
 , m_listener(0)
 , m_finished(false)
@@ -405,13 +424,31 @@ void CurlDownload::moveFileToDestination()
 #endif
 }
 
-void CurlDownload::writeDataToFile(const char* data, int size)
+bool CurlDownload::writeDataToFile(const char* data, int size)
 {
+#if OS(LINUX)
+    // Segments of one download share the file, each at its own offset
+    if (m_outputHandle != invalidPlatformFileHandle) {
+        while (size > 0) {
+            ssize_t written = pwrite(m_outputHandle, data, size, m_outputOffset);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= written;
+            m_outputOffset += written;
+        }
+        return true;
+    }
+#endif
+
     if (m_tempPath.isEmpty())
         m_tempPath = openTemporaryFile("download", m_tempHandle);
 
     if (m_tempHandle != invalidPlatformFileHandle)
         writeToFile(m_tempHandle, data, size);
+    return true;
 }
 
 void CurlDownload::addHeaders(const ResourceRequest& request)
@@ -442,7 +479,38 @@ void CurlDownload::addHeaders(const ResourceRequest& request)
     }
 }
 
-void CurlDownload::didReceiveHeader(const String& header)
+void CurlDownload::setRange(long long start, long long end, const String& ifRange)
+{
+    MutexLocker locker(m_mutex);
+
+    m_rangeStart = start;
+
+    String range = String::number(start) + "-";
+    if (end >= 0)
+        range.append(String::number(end));
+    curl_easy_setopt(m_curlHandle, CURLOPT_RANGE, range.latin1().data());
+
+    if (!ifRange.isEmpty()) {
+        String header = "If-Range: " + ifRange;
+        m_customHeaders = curl_slist_append(m_customHeaders, header.latin1().data());
+        curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, m_customHeaders);
+    }
+}
+
+void CurlDownload::setOutputFile(PlatformFileHandle handle, long long offset)
+{
+    MutexLocker locker(m_mutex);
+
+    m_outputHandle = handle;
+    m_outputOffset = offset;
+}
+
+bool CurlDownload::checksResponse() const
+{
+    return m_outputHandle != invalidPlatformFileHandle || m_rangeStart > 0;
+}
+
+bool CurlDownload::didReceiveHeader(const String& header)
 {
     MutexLocker locker(m_mutex);
 
@@ -451,7 +519,21 @@ void CurlDownload::didReceiveHeader(const String& header)
         long httpCode = 0;
         CURLcode err = curl_easy_getinfo(m_curlHandle, CURLINFO_RESPONSE_CODE, &httpCode);
 
-        if (httpCode >= 200 && httpCode < 300) {
+        // An error page or the whole file written at this offset would be
+        // garbage. Only the range asked for, or all of it from the start.
+        if (checksResponse()) {
+            m_responseAccepted = httpCode == 206 || (httpCode == 200 && !m_rangeStart);
+
+            // An empty file has no bytes to give, asked for from the start it
+            // answers 416 with Content-Range: bytes */0. That is all of it.
+            m_emptyRange = httpCode == 416 && !m_rangeStart
+                && m_response->httpHeaderField(String("Content-Range")).endsWith("*/0");
+            m_responseAccepted |= m_emptyRange;
+        }
+
+        if ((httpCode >= 200 && httpCode < 300) || m_emptyRange) {
+            m_response->setHTTPStatusCode(httpCode);
+
             const char* url = 0;
             err = curl_easy_getinfo(m_curlHandle, CURLINFO_EFFECTIVE_URL, &url);
             m_response->setURL(URL(ParsedURLString, url));
@@ -472,22 +554,39 @@ void CurlDownload::didReceiveHeader(const String& header)
                 didReceiveResponse();
             });
         }
+
+        // Interim responses and followed redirects have no body to check,
+        // anything else fails the transfer now
+        bool interim = (httpCode >= 100 && httpCode < 200) || (httpCode >= 300 && httpCode < 400);
+        if (checksResponse() && !m_responseAccepted && !interim)
+            return false;
     } else {
         int splitPos = header.find(":");
         if (splitPos != -1)
             m_response->setHTTPHeaderField(header.left(splitPos), header.substring(splitPos+1).stripWhiteSpace());
     }
+    return true;
 }
 
-void CurlDownload::didReceiveData(void* data, int size)
+bool CurlDownload::didReceiveData(void* data, int size)
 {
     MutexLocker locker(m_mutex);
 
+    if (checksResponse() && !m_responseAccepted)
+        return false;
+
+    // The 416's body is an error page, not the file
+    if (m_emptyRange)
+        return true;
+
+    if (!writeDataToFile(static_cast<const char*>(data), size))
+        return false;
+
+    // Only count what is on disk, a resume starts from there
     callOnMainThread([this, size] {
         didReceiveDataOfLength(size);
     });
-
-    writeDataToFile(static_cast<const char*>(data), size);
+    return true;
 }
 
 void CurlDownload::didReceiveResponse()
@@ -504,6 +603,18 @@ void CurlDownload::didReceiveDataOfLength(int size)
 
 void CurlDownload::didFinish()
 {
+    // A redirect without a Location ends the transfer fine, but not with
+    // the response asked for
+    bool rejected;
+    {
+        MutexLocker locker(m_mutex);
+        rejected = checksResponse() && !m_responseAccepted;
+    }
+    if (rejected) {
+        didFail();
+        return;
+    }
+
     MutexLocker locker(m_mutex);
 
     closeFile();
@@ -532,8 +643,9 @@ size_t CurlDownload::writeCallback(void* ptr, size_t size, size_t nmemb, void* d
     size_t totalSize = size * nmemb;
     CurlDownload* download = reinterpret_cast<CurlDownload*>(data);
 
-    if (download)
-        download->didReceiveData(ptr, totalSize);
+    // Anything short of totalSize makes curl fail the transfer
+    if (download && !download->didReceiveData(ptr, totalSize))
+        return 0;
 
     return totalSize;
 }
@@ -545,8 +657,8 @@ size_t CurlDownload::headerCallback(char* ptr, size_t size, size_t nmemb, void*
 
     String header(static_cast<const char*>(ptr), totalSize);
 
-    if (download)
-        download->didReceiveHeader(header);
+    if (download && !download->didReceiveHeader(header))
+        return 0;
 
     return totalSize;
 }
@@ -59,6 +59,7 @@ private:
     void stopThreadIfIdle();
 
     void updateHandleList();
+    void wakeThread();
 
     CURLM* getMultiHandle() const { return m_curlMultiHandle; }
 
@@ -72,6 +73,7 @@ private:
 
     ThreadIdentifier m_threadId;
     CURLM* m_curlMultiHandle;
+    int m_wakeup[2];
     Vector<CURL*> m_pendingHandleList;
     Vector<CURL*> m_activeHandleList;
     Vector<CURL*> m_removedHandleList;
@@ -109,14 +111,28 @@ public:
 
     void addHeaders(const ResourceRequest&);
 
+    // Fetch only these bytes, end inclusive or -1 for the rest. Call after
+    // addHeaders(). A range not from the start fails unless the server
+    // sends just that range; ifRange is an ETag or date it must match.
+    void setRange(long long start, long long end, const String& ifRange = String());
+
+    // Write the body into this file from the offset on, instead of into a
+    // temp file moved to the destination. The file stays the caller's.
+    // A status other than 206, or 200 for a request from the start, fails.
+    // So does a 416, unless it is from the start and the file is empty.
+    void setOutputFile(PlatformFileHandle, long long offset);
+
 private:
     void closeFile();
     void moveFileToDestination();
-    void writeDataToFile(const char* data, int size);
+    bool writeDataToFile(const char* data, int size);
+
+    // Ranged and shared-file downloads only take a 206, or a 200 from the start
+    bool checksResponse() const;
 
     // Called on download thread.
-    void didReceiveHeader(const String& header);
-    void didReceiveData(void* data, int size);
+    bool didReceiveHeader(const String& header);
+    bool didReceiveData(void* data, int size);
 
     // Called on main thread.
     void didReceiveResponse();
@@ -138,6 +154,11 @@ private:
     String m_tempPath;
     String m_destination;
     WebCore::PlatformFileHandle m_tempHandle;
+    WebCore::PlatformFileHandle m_outputHandle;
+    long long m_outputOffset;
+    long long m_rangeStart;
+    bool m_responseAccepted;
+    bool m_emptyRange; // 416 for an empty file, accepted with no body
     WebCore::ResourceResponse *m_response;
     bool m_deletesFileUponFailure;
     mutable Mutex m_mutex;
@@ -25,16 +25,45 @@
 
 #include "config.h"
 #include "DNS.h"
+#include "DNSResolveQueue.h"
 
 #if USE(CURL)
 
-#include "NotImplemented.h"
+#include "ResourceHandleManager.h"
+#include <wtf/MainThread.h>
 
 namespace WebCore {
 
-void prefetchDNS(const String& /* hostname */)
+bool DNSResolveQueue::platformProxyIsEnabledInSystemPreferences()
 {
-    notImplemented();
+    return ResourceHandleManager::sharedInstance()->usesProxy();
+}
+
+static void resolvedCallback()
+{
+    DNSResolveQueue::singleton().decrementRequestCount();
+}
+
+void DNSResolveQueue::platformResolve(const String& hostname)
+{
+    ASSERT(isMainThread());
+
+    // Curl caches addresses per host and port, so warm both the
+    // https and http entries. The second counts as its own request.
+    ++m_requestsInFlight;
+
+    ResourceHandleManager* manager = ResourceHandleManager::sharedInstance();
+    manager->prefetchDNS(hostname, 443, resolvedCallback);
+    manager->prefetchDNS(hostname, 80, resolvedCallback);
+}
+
+void prefetchDNS(const String& hostname)
+{
+    ASSERT(isMainThread());
+    if (hostname.isEmpty())
+        return;
+
+    DNSResolveQueue::singleton().add(hostname);
 }
 
 }
@@ -0,0 +1,117 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include "FileURL.h"
+
+#include "FileMetadata.h"
+#include "FileSystem.h"
+#include "MIMETypeRegistry.h"
+#include "ResourceError.h"
+#include "ResourceHandle.h"
+#include "ResourceHandleClient.h"
+#include "ResourceRequest.h"
+#include "ResourceResponse.h"
+#include "SharedBuffer.h"
+#include <curl/curl.h>
+#include <wtf/text/CString.h>
+
+namespace WebCore {
+
+static const char* (*directoryListingFunction)(const char*);
+
+void setDirectoryListingFunction(const char* (*function)(const char*))
+{
+    directoryListingFunction = function;
+}
+
+// Same code as curl's file:// errors, so clients treat both alike
+static void didFail(ResourceHandle* handle, const URL& url)
+{
+    ResourceError error(String(), CURLE_FILE_COULDNT_READ_FILE, url.string(), String(curl_easy_strerror(CURLE_FILE_COULDNT_READ_FILE)));
+    handle->client()->didFail(handle, error);
+}
+
+static PassRefPtr<SharedBuffer> directoryListing(const String& path)
+{
+    if (!directoryListingFunction)
+        return nullptr;
+
+    char* listing = const_cast<char*>(directoryListingFunction(fileSystemRepresentation(path).data()));
+    if (!listing)
+        return nullptr;
+
+    RefPtr<SharedBuffer> buffer = SharedBuffer::create(listing, strlen(listing));
+    free(listing);
+    return buffer.release();
+}
+
+void handleFileURL(ResourceHandle* handle)
+{
+    URL url = handle->firstRequest().url();
+    ASSERT(url.isLocalFile());
+
+    // Queries and fragments don't name a different file
+    url.setQuery(String());
+    url.removeFragmentIdentifier();
+
+    String path = url.fileSystemPath();
+    ResourceResponse response;
+    response.setURL(url);
+
+    FileMetadata metadata;
+    if (!getFileMetadata(path, metadata)) {
+        didFail(handle, url);
+        return;
+    }
+
+    RefPtr<SharedBuffer> buffer;
+    if (metadata.type == FileMetadata::TypeDirectory) {
+        buffer = directoryListing(path);
+        if (!buffer) {
+            didFail(handle, url);
+            return;
+        }
+        response.setMimeType("text/html");
+        response.setTextEncodingName("UTF-8");
+    } else {
+        // One read into a single buffer, no copies after that
+        if (metadata.length) {
+            buffer = SharedBuffer::createWithContentsOfFile(path);
+            if (!buffer) {
+                didFail(handle, url);
+                return;
+            }
+        }
+        response.setMimeType(MIMETypeRegistry::getMIMETypeForPath(url));
+    }
+
+    response.setExpectedContentLength(buffer ? buffer->size() : 0);
+    handle->client()->didReceiveResponse(handle, response);
+    if (!handle->client())
+        return;
+
+    if (buffer) {
+        unsigned length = buffer->size();
+        handle->client()->didReceiveBuffer(handle, buffer.release(), length);
+        if (!handle->client())
+            return;
+    }
+
+    handle->client()->didFinishLoading(handle, 0);
+}
+
+} // namespace WebCore
@@ -0,0 +1,35 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FileURL_h
+#define FileURL_h
+
+namespace WebCore {
+
+class ResourceHandle;
+
+// Loads a file:// URL without curl. A regular file is read in one go and
+// handed to the client as one buffer, a directory goes to the listing
+// function.
+void handleFileURL(ResourceHandle*);
+
+// Returns the HTML listing of a directory path, malloc'd. Without one,
+// directories fail to load.
+void setDirectoryListingFunction(const char* (*)(const char* path));
+
+}
+
+#endif // FileURL_h
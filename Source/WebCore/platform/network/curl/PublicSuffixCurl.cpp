@@ -0,0 +1,58 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include "PublicSuffix.h"
+
+#if ENABLE(PUBLIC_SUFFIX_LIST)
+
+#include <libpsl.h>
+#include <wtf/text/CString.h>
+
+namespace WebCore {
+
+// The system's list if there is one, else the one built into libpsl.
+// Read-only once loaded, so cookies parsed off the main thread can use it.
+static const psl_ctx_t* suffixList()
+{
+    static const psl_ctx_t* list = psl_latest(nullptr);
+    return list;
+}
+
+bool isPublicSuffix(const String& domain)
+{
+    if (domain.isEmpty() || !suffixList())
+        return false;
+
+    CString utf8 = domain.lower().utf8();
+    return psl_is_public_suffix2(suffixList(), utf8.data(), PSL_TYPE_ANY);
+}
+
+String topPrivatelyControlledDomain(const String& domain)
+{
+    if (domain.isEmpty() || !suffixList())
+        return String();
+
+    CString utf8 = domain.lower().utf8();
+    const char* registrable = psl_registrable_domain(suffixList(), utf8.data());
+    if (!registrable)
+        return String();
+    return String::fromUTF8(registrable);
+}
+
+} // namespace WebCore
+
+#endif // ENABLE(PUBLIC_SUFFIX_LIST)
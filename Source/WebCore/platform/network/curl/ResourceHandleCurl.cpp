@@ -155,6 +155,13 @@ void ResourceHandle::platformSetDefersLoading(bool defers)
     if (!d->m_handle)
         return;
 
+    ResourceHandleManager* manager = ResourceHandleManager::sharedInstance();
+    if (manager->usesNetworkThread()) {
+        if (!defers)
+            manager->resumeDeferredEvents();
+        return;
+    }
+
     if (defers) {
         CURLcode error = curl_easy_pause(d->m_handle, CURLPAUSE_ALL);
         // If we could not defer the handle, so don't do it.
@@ -198,7 +205,7 @@ void ResourceHandle::didReceiveAuthenticationChallenge(const AuthenticationChall
         CredentialStorage::set(credential, challenge.protectionSpace(), urlToStore);
         
         String userpass = credential.user() + ":" + credential.password();
-        curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
+        ResourceHandleManager::sharedInstance()->setCredentials(this, userpass);
 
         d->m_user = String();
         d->m_pass = String();
@@ -223,7 +230,7 @@ void ResourceHandle::didReceiveAuthenticationChallenge(const AuthenticationChall
                     CredentialStorage::set(credential, challenge.protectionSpace(), challenge.failureResponse().url());
                 }
                 String userpass = credential.user() + ":" + credential.password();
-                curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
+                ResourceHandleManager::sharedInstance()->setCredentials(this, userpass);
                 return;
             }
         }
@@ -253,7 +260,7 @@ void ResourceHandle::receivedCredential(const AuthenticationChallenge& challenge
     }
 
     String userpass = credential.user() + ":" + credential.password();
-    curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
+    ResourceHandleManager::sharedInstance()->setCredentials(this, userpass);
 
     clearAuthentication();
 }
@@ -264,7 +271,7 @@ void ResourceHandle::receivedRequestToContinueWithoutCredential(const Authentica
         return;
 
     String userpass = "";
-    curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
+    ResourceHandleManager::sharedInstance()->setCredentials(this, userpass);
 
     clearAuthentication();
 }
@@ -42,6 +42,7 @@
 #include "CredentialStorage.h"
 #include "CurlCacheManager.h"
 #include "DataURL.h"
+#include "FileURL.h"
 #include "HTTPHeaderNames.h"
 #include "HTTPParsers.h"
 #include "MIMETypeRegistry.h"
@@ -61,13 +62,21 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
+#if PLATFORM(FLTK)
+#include <FL/Fl.H>
+#include <sys/epoll.h>
+#endif
 #if ENABLE(WEB_TIMING)
 #include <wtf/CurrentTime.h>
 #endif
 #if USE(CF)
 #include <wtf/RetainPtr.h>
 #endif
+#include <wtf/HashSet.h>
+#include <wtf/MainThread.h>
 #include <wtf/Threading.h>
 #include <wtf/Vector.h>
 #include <wtf/text/CString.h>
@@ -77,9 +86,12 @@ extern const char *wk_cookiepath;
 
 namespace WebCore {
 
+#if !PLATFORM(FLTK)
 // only when waiting on network traffic, poll by this much
 const double pollTimeSeconds = 0.02;
-const int maxRunningJobs = 128;
+#endif
+const unsigned defaultMaxRunningJobs = 128;
+const unsigned defaultMaxJobsPerHost = 6;
 
 static const bool ignoreSSLErrors = getenv("WEBKIT_IGNORE_SSL_ERRORS");
 
@@ -244,6 +256,11 @@ ResourceHandleManager::ResourceHandleManager()
     , m_cookieJarFileName(cookieJarPath())
     , m_certificatePath (certificatePath())
     , m_runningJobs(0)
+    , m_needsScheduling(false)
+    , m_maxRunningJobs(defaultMaxRunningJobs)
+    , m_maxJobsPerHost(defaultMaxJobsPerHost)
+    , m_useNetworkThread(false)
+    , m_networkMultiHandle(nullptr)
 #ifndef NDEBUG
     , m_logFile(nullptr)
 #endif
@@ -256,6 +273,22 @@ ResourceHandleManager::ResourceHandleManager()
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_LOCKFUNC, curl_lock_callback);
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_UNLOCKFUNC, curl_unlock_callback);
 
+#if PLATFORM(FLTK)
+    // Curl's sockets live in an epoll set, whose single fd is watched by FLTK.
+    // This wakes us exactly when there is data, and is not limited by FD_SETSIZE.
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    Fl::add_fd(m_epollFd, FL_READ, socketActivity, this);
+
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_SOCKETFUNCTION, socketCallback);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_TIMERFUNCTION, timerCallback);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_TIMERDATA, this);
+#endif
+
     initCookieSession();
 
 #ifndef NDEBUG
@@ -268,6 +301,11 @@ ResourceHandleManager::ResourceHandleManager()
 ResourceHandleManager::~ResourceHandleManager()
 {
     curl_multi_cleanup(m_curlMultiHandle);
+#if PLATFORM(FLTK)
+    Fl::remove_fd(m_epollFd);
+    close(m_epollFd);
+#endif
+    m_cookieStore = nullptr;
     curl_share_cleanup(m_curlShareHandle);
     if (m_cookieJarFileName)
         fastFree(m_cookieJarFileName);
@@ -286,7 +324,10 @@ CURLSH* ResourceHandleManager::getCurlShareHandle() const
 
 void ResourceHandleManager::setCookieJarFileName(const char* cookieJarFileName)
 {
+    if (m_cookieJarFileName)
+        fastFree(m_cookieJarFileName);
     m_cookieJarFileName = fastStrDup(cookieJarFileName);
+    initCookieSession();
 }
 
 const char* ResourceHandleManager::getCookieJarFileName() const
@@ -302,27 +343,63 @@ ResourceHandleManager* ResourceHandleManager::sharedInstance()
     return sharedInstance;
 }
 
-static void handleLocalReceiveResponse (CURL* handle, ResourceHandle* job, ResourceHandleInternal* d)
+// The parts of the curl handle state the callbacks need. With the network
+// thread, this is captured there, as the handle is not ours to query.
+struct TransferInfo {
+    CString effectiveURL;
+    long httpCode { 0 };
+    double contentLength { 0 };
+    long port { 0 };
+    long availableAuth { CURLAUTH_NONE };
+};
+
+static void getTransferInfo(CURL* handle, TransferInfo& info)
+{
+    const char* url = 0;
+    curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url);
+    info.effectiveURL = url;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &info.httpCode);
+    curl_easy_getinfo(handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &info.contentLength);
+    curl_easy_getinfo(handle, CURLINFO_PRIMARY_PORT, &info.port);
+    curl_easy_getinfo(handle, CURLINFO_HTTPAUTH_AVAIL, &info.availableAuth);
+}
+
+static void handleLocalReceiveResponse(const TransferInfo& info, ResourceHandle* job, ResourceHandleInternal* d)
 {
     // since the code in headerCallback will not have run for local files
     // the code to set the URL and fire didReceiveResponse is never run,
     // which means the ResourceLoader's response does not contain the URL.
     // Run the code here for local files to resolve the issue.
     // TODO: See if there is a better approach for handling this.
-     const char* hdr;
-     CURLcode err = curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &hdr);
-     ASSERT_UNUSED(err, CURLE_OK == err);
-     d->m_response.setURL(URL(ParsedURLString, hdr));
+     d->m_response.setURL(URL(ParsedURLString, info.effectiveURL.data()));
      if (d->client())
          d->client()->didReceiveResponse(job, d->m_response);
      d->m_response.setResponseFired(true);
 }
 
+// Something the network thread saw, to be replayed on the main thread.
+struct NetworkEvent {
+    enum Type {
+        Header,
+        Data,
+        Done
+    };
 
-// called with data after all headers have been processed via headerCallback
-static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
+    NetworkEvent(ResourceHandle* job, Type type)
+        : job(job)
+        , type(type)
+    {
+    }
+
+    ResourceHandle* job;
+    Type type;
+    Vector<char> data;
+    TransferInfo info;
+    CURLcode result { CURLE_OK };
+};
+
+static size_t processData(ResourceHandle* job, const char* ptr, size_t totalSize, const TransferInfo& info)
 {
-    ResourceHandle* job = static_cast<ResourceHandle*>(data);
     ResourceHandleInternal* d = job->getInternal();
     if (d->m_cancelled)
         return 0;
@@ -330,19 +407,14 @@ static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
     // We should never be called when deferred loading is activated.
     ASSERT(!d->m_defersLoading);
 
-    size_t totalSize = size * nmemb;
-
     // this shouldn't be necessary but apparently is. CURL writes the data
     // of html page even if it is a redirect that was handled internally
     // can be observed e.g. on gmail.com
-    CURL* h = d->m_handle;
-    long httpCode = 0;
-    CURLcode err = curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &httpCode);
-    if (CURLE_OK == err && httpCode >= 300 && httpCode < 400)
+    if (info.httpCode >= 300 && info.httpCode < 400)
         return totalSize;
 
     if (!d->m_response.responseFired()) {
-        handleLocalReceiveResponse(h, job, d);
+        handleLocalReceiveResponse(info, job, d);
         if (d->m_cancelled)
             return 0;
     }
@@ -350,13 +422,33 @@ static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
     if (d->m_multipartHandle)
         d->m_multipartHandle->contentReceived(static_cast<const char*>(ptr), totalSize);
     else if (d->client()) {
-        d->client()->didReceiveData(job, static_cast<char*>(ptr), totalSize, 0);
-        CurlCacheManager::getInstance().didReceiveData(*job, static_cast<char*>(ptr), totalSize);
+        d->client()->didReceiveData(job, ptr, totalSize, 0);
+        CurlCacheManager::getInstance().didReceiveData(*job, ptr, totalSize);
     }
 
     return totalSize;
 }
 
+// called with data after all headers have been processed via headerCallback
+static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    ResourceHandle* job = static_cast<ResourceHandle*>(data);
+    ResourceHandleInternal* d = job->getInternal();
+    if (d->m_cancelled)
+        return 0;
+
+    // Only what processData needs, this runs for every chunk.
+    TransferInfo info;
+    curl_easy_getinfo(d->m_handle, CURLINFO_RESPONSE_CODE, &info.httpCode);
+    if (!d->m_response.responseFired()) {
+        const char* url = 0;
+        curl_easy_getinfo(d->m_handle, CURLINFO_EFFECTIVE_URL, &url);
+        info.effectiveURL = url;
+    }
+
+    return processData(job, static_cast<const char*>(ptr), size * nmemb, info);
+}
+
 static bool isAppendableHeader(const String &key)
 {
     static const char* appendableHeaders[] = {
@@ -407,26 +499,15 @@ static void removeLeadingAndTrailingQuotes(String& value)
         value = value.substring(1, length-2);
 }
 
-static bool getProtectionSpace(CURL* h, const ResourceResponse& response, ProtectionSpace& protectionSpace)
+static bool getProtectionSpace(const TransferInfo& info, const ResourceResponse& response, ProtectionSpace& protectionSpace)
 {
-    CURLcode err;
-
-    long port = 0;
-    err = curl_easy_getinfo(h, CURLINFO_PRIMARY_PORT, &port);
-    if (err != CURLE_OK)
-        return false;
-
-    long availableAuth = CURLAUTH_NONE;
-    err = curl_easy_getinfo(h, CURLINFO_HTTPAUTH_AVAIL, &availableAuth);
-    if (err != CURLE_OK)
+    if (info.effectiveURL.isNull())
         return false;
 
-    const char* effectiveUrl = 0;
-    err = curl_easy_getinfo(h, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
-    if (err != CURLE_OK)
-        return false;
+    const long port = info.port;
+    const long availableAuth = info.availableAuth;
 
-    URL url(ParsedURLString, effectiveUrl);
+    URL url(ParsedURLString, info.effectiveURL.data());
 
     String host = url.host();
     String protocol = url.protocol();
@@ -471,9 +552,8 @@ static bool getProtectionSpace(CURL* h, const ResourceResponse& response, Protec
  * update the ResourceResponse and then send it away.
  *
  */
-static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
+static size_t processHeader(ResourceHandle* job, const char* ptr, size_t totalSize, const TransferInfo& info)
 {
-    ResourceHandle* job = static_cast<ResourceHandle*>(data);
     ResourceHandleInternal* d = job->getInternal();
     if (d->m_cancelled)
         return 0;
@@ -481,15 +561,11 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
     // We should never be called when deferred loading is activated.
     ASSERT(!d->m_defersLoading);
 
-    size_t totalSize = size * nmemb;
     ResourceHandleClient* client = d->client();
 
-    String header(static_cast<const char*>(ptr), totalSize);
+    String header(ptr, totalSize);
 
-    CURL* h = d->m_handle;
-    const char* effectiveURL;
-    curl_easy_getinfo(h, CURLINFO_EFFECTIVE_URL, &effectiveURL);
-    const URL url(URL(), effectiveURL);
+    const URL url(URL(), info.effectiveURL.data());
 
     if (url.protocol() == "ftp") {
         static bool modeAscii = false;
@@ -518,8 +594,7 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
      * accept also \n.
      */
     if (header == String("\r\n") || header == String("\n")) {
-        long httpCode = 0;
-        curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &httpCode);
+        const long httpCode = info.httpCode;
 
         if (isHttpInfo(httpCode)) {
             // Just return when receiving http info, e.g. HTTP/1.1 100 Continue.
@@ -527,9 +602,7 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
             return totalSize;
         }
 
-        double contentLength = 0;
-        curl_easy_getinfo(h, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &contentLength);
-        d->m_response.setExpectedContentLength(static_cast<long long int>(contentLength));
+        d->m_response.setExpectedContentLength(static_cast<long long int>(info.contentLength));
 
         d->m_response.setURL(url);
 
@@ -566,7 +639,7 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
             }
         } else if (isHttpAuthentication(httpCode)) {
             ProtectionSpace protectionSpace;
-            if (getProtectionSpace(d->m_handle, d->m_response, protectionSpace)) {
+            if (getProtectionSpace(info, d->m_response, protectionSpace)) {
                 Credential credential;
                 AuthenticationChallenge challenge(protectionSpace, credential, d->m_authFailureCount, d->m_response, ResourceError());
                 challenge.setAuthenticationClient(job);
@@ -597,6 +670,10 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
             String key = header.left(splitPos).stripWhiteSpace();
             String value = header.substring(splitPos + 1).stripWhiteSpace();
 
+            // Curl stores the cookie itself, keep the DOM view in sync
+            if (equalIgnoringCase(key, "set-cookie"))
+                ResourceHandleManager::sharedInstance()->cookieStore().didReceiveSetCookie(url, value);
+
             if (isAppendableHeader(key))
                 d->m_response.addHTTPHeaderField(key, value);
             else
@@ -608,10 +685,7 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
             // If the FOLLOWLOCATION option is enabled for the curl handle then
             // curl will follow the redirections internally. Thus this header callback
             // will be called more than one time with the line starting "HTTP" for one job.
-            long httpCode = 0;
-            curl_easy_getinfo(d->m_handle, CURLINFO_RESPONSE_CODE, &httpCode);
-
-            String httpCodeString = String::number(httpCode);
+            String httpCodeString = String::number(info.httpCode);
             int statusCodePos = header.find(httpCodeString);
 
             if (statusCodePos != -1) {
@@ -626,6 +700,18 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
     return totalSize;
 }
 
+static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
+{
+    ResourceHandle* job = static_cast<ResourceHandle*>(data);
+    ResourceHandleInternal* d = job->getInternal();
+    if (d->m_cancelled)
+        return 0;
+
+    TransferInfo info;
+    getTransferInfo(d->m_handle, info);
+    return processHeader(job, ptr, size * nmemb, info);
+}
+
 /* Called for HTTP(S) POST uploads on some sites, curl already sent data but
    needs to re-send it. Simpler interface than the seek one.
 */
@@ -669,12 +755,99 @@ size_t readCallback(void* ptr, size_t size, size_t nmemb, void* data)
     size_t sent = d->m_formDataStream.read(ptr, size, nmemb);
 
     // Something went wrong so cancel the job.
-    if (!sent)
+    if (!sent) {
+        if (!isMainThread())
+            return CURL_READFUNC_ABORT;
         job->cancel();
+    }
 
     return sent;
 }
 
+#if PLATFORM(FLTK)
+int ResourceHandleManager::socketCallback(CURL*, curl_socket_t fd, int what, void* data, void*)
+{
+    ResourceHandleManager* self = static_cast<ResourceHandleManager*>(data);
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(self->m_epollFd, EPOLL_CTL_DEL, fd, 0);
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = fd;
+    if (what & CURL_POLL_IN)
+        ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT)
+        ev.events |= EPOLLOUT;
+
+    if (epoll_ctl(self->m_epollFd, EPOLL_CTL_MOD, fd, &ev) && errno == ENOENT)
+        epoll_ctl(self->m_epollFd, EPOLL_CTL_ADD, fd, &ev);
+
+    return 0;
+}
+
+int ResourceHandleManager::timerCallback(CURLM*, long timeoutMs, void* data)
+{
+    ResourceHandleManager* self = static_cast<ResourceHandleManager*>(data);
+
+    // Jobs waiting for a free slot must not be delayed by curl's timeouts.
+    if (self->m_needsScheduling)
+        timeoutMs = 0;
+
+    if (timeoutMs < 0)
+        self->m_downloadTimer.stop();
+    else
+        self->m_downloadTimer.startOneShot(timeoutMs / 1000.0);
+
+    return 0;
+}
+
+void ResourceHandleManager::socketActivity(int, void* data)
+{
+    ResourceHandleManager* self = static_cast<ResourceHandleManager*>(data);
+
+    enum {
+        maxEvents = 64
+    };
+    struct epoll_event events[maxEvents];
+    int runningHandles = 0;
+    int count;
+
+    do {
+        count = epoll_wait(self->m_epollFd, events, maxEvents, 0);
+        for (int i = 0; i < count; i++) {
+            int flags = 0;
+            if (events[i].events & EPOLLIN)
+                flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT)
+                flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(self->m_curlMultiHandle, events[i].data.fd, flags, &runningHandles);
+        }
+    } while (count == maxEvents);
+
+    self->processCompletedJobs();
+    self->startScheduledJobs();
+}
+
+void ResourceHandleManager::downloadTimerCallback()
+{
+    startScheduledJobs();
+
+    // Socket activity is handled in socketActivity, here we only need
+    // to let curl run its timeouts.
+    int runningHandles = 0;
+    curl_multi_socket_action(m_curlMultiHandle, CURL_SOCKET_TIMEOUT, 0, &runningHandles);
+
+    processCompletedJobs();
+
+    // new jobs might have been added in the meantime
+    startScheduledJobs();
+}
+#else
 void ResourceHandleManager::downloadTimerCallback()
 {
     bool again = false;
@@ -718,6 +891,57 @@ void ResourceHandleManager::downloadTimerCallback()
     int runningHandles = 0;
     while (curl_multi_perform(m_curlMultiHandle, &runningHandles) == CURLM_CALL_MULTI_PERFORM) { }
 
+    processCompletedJobs();
+
+    // if we had any activity, immediately select again to drain all kernel buffers
+    if (again) {
+        downloadTimerCallback();
+        return;
+    }
+
+    bool started = startScheduledJobs(); // new jobs might have been added in the meantime
+
+    if (!m_downloadTimer.isActive() && (started || (runningHandles > 0)))
+        m_downloadTimer.startOneShot(pollTimeSeconds);
+}
+#endif
+
+// Tells the client how the transfer ended. The caller removes the job from curl.
+static void finishJob(ResourceHandle* job, CURLcode result, const TransferInfo& info)
+{
+    ResourceHandleInternal* d = job->getInternal();
+
+    if (CURLE_OK == result) {
+        if (!d->m_response.responseFired()) {
+            handleLocalReceiveResponse(info, job, d);
+            if (d->m_cancelled)
+                return;
+        }
+
+        if (d->m_multipartHandle)
+            d->m_multipartHandle->contentEnded();
+
+        if (d->client()) {
+            d->client()->didFinishLoading(job, 0);
+            CurlCacheManager::getInstance().didFinishLoading(*job);
+        }
+    } else {
+        const char* url = info.effectiveURL.data();
+        URL tmpurl(URL(), url);
+#ifndef NDEBUG
+        fprintf(stderr, "Curl ERROR for url='%s', error: '%s'\n", url, curl_easy_strerror(result));
+#endif
+        if (d->client()) {
+            ResourceError resourceError(tmpurl.host(), result, String(url), String(curl_easy_strerror(result)));
+            resourceError.setSSLErrors(d->m_sslErrors);
+            d->client()->didFail(job, resourceError);
+            CurlCacheManager::getInstance().didFail(*job);
+        }
+    }
+}
+
+void ResourceHandleManager::processCompletedJobs()
+{
     // check the curl messages indicating completed transfers
     // and free their resources
     while (true) {
@@ -729,6 +953,17 @@ void ResourceHandleManager::downloadTimerCallback()
         // find the node which has same d->m_handle as completed transfer
         CURL* handle = msg->easy_handle;
         ASSERT(handle);
+
+        auto prefetch = m_dnsPrefetches.find(handle);
+        if (prefetch != m_dnsPrefetches.end()) {
+            std::function<void()> completion = WTF::move(prefetch->value);
+            m_dnsPrefetches.remove(prefetch);
+            curl_multi_remove_handle(m_curlMultiHandle, handle);
+            curl_easy_cleanup(handle);
+            completion();
+            continue;
+        }
+
         ResourceHandle* job = 0;
         CURLcode err = curl_easy_getinfo(handle, CURLINFO_PRIVATE, &job);
         ASSERT_UNUSED(err, CURLE_OK == err);
@@ -746,54 +981,247 @@ void ResourceHandleManager::downloadTimerCallback()
         if (CURLMSG_DONE != msg->msg)
             continue;
 
-
-        if (CURLE_OK == msg->data.result) {
 #if ENABLE(WEB_TIMING)
+        if (CURLE_OK == msg->data.result)
             calculateWebTimingInformations(d);
 #endif
-            if (!d->m_response.responseFired()) {
-                handleLocalReceiveResponse(d->m_handle, job, d);
-                if (d->m_cancelled) {
-                    removeFromCurl(job);
-                    continue;
-                }
-            }
 
-            if (d->m_multipartHandle)
-                d->m_multipartHandle->contentEnded();
+        TransferInfo info;
+        getTransferInfo(handle, info);
+        finishJob(job, msg->data.result, info);
+
+        removeFromCurl(job);
+    }
+}
+
+size_t ResourceHandleManager::networkHeaderCallback(char* ptr, size_t size, size_t nmemb, void* data)
+{
+    ResourceHandle* job = static_cast<ResourceHandle*>(data);
+    ResourceHandleInternal* d = job->getInternal();
+    if (d->m_cancelled)
+        return 0;
+
+    auto event = std::make_unique<NetworkEvent>(job, NetworkEvent::Header);
+    event->data.append(ptr, size * nmemb);
+    getTransferInfo(d->m_handle, event->info);
+    sharedInstance()->m_threadEvents.append(WTF::move(event));
+
+    return size * nmemb;
+}
+
+size_t ResourceHandleManager::networkWriteCallback(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    ResourceHandle* job = static_cast<ResourceHandle*>(data);
+    ResourceHandleInternal* d = job->getInternal();
+    if (d->m_cancelled)
+        return 0;
+
+    auto event = std::make_unique<NetworkEvent>(job, NetworkEvent::Data);
+    event->data.append(static_cast<const char*>(ptr), size * nmemb);
+    const char* url = 0;
+    curl_easy_getinfo(d->m_handle, CURLINFO_EFFECTIVE_URL, &url);
+    event->info.effectiveURL = url;
+    curl_easy_getinfo(d->m_handle, CURLINFO_RESPONSE_CODE, &event->info.httpCode);
+    sharedInstance()->m_threadEvents.append(WTF::move(event));
+
+    return size * nmemb;
+}
+
+void ResourceHandleManager::enableNetworkThread()
+{
+    ASSERT(isMainThread());
+    if (m_useNetworkThread)
+        return;
+    ASSERT(!m_runningJobs);
+
+    if (pipe(m_networkWakeup) == -1) {
+        perror("pipe");
+        return;
+    }
+    fcntl(m_networkWakeup[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_networkWakeup[1], F_SETFL, O_NONBLOCK);
+
+    m_networkMultiHandle = curl_multi_init();
+    m_useNetworkThread = true;
+
+    ThreadIdentifier thread = createThread("WebCore: Network", [this] {
+        networkThread();
+    });
+    detachThread(thread);
+}
+
+void ResourceHandleManager::setCredentials(ResourceHandle* job, const String& userpass)
+{
+    ResourceHandleInternal* d = job->getInternal();
+    if (!d->m_handle)
+        return;
+
+    if (!d->m_threaded) {
+        curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
+        return;
+    }
+
+    {
+        MutexLocker lock(m_networkMutex);
+        m_networkCredentials.append(std::make_pair(job, userpass.utf8()));
+    }
+    wakeNetworkThread();
+}
+
+void ResourceHandleManager::wakeNetworkThread()
+{
+    // A full pipe means a wakeup is pending already.
+    char c = 0;
+    write(m_networkWakeup[1], &c, 1);
+}
+
+void ResourceHandleManager::networkThread()
+{
+    HashSet<ResourceHandle*> activeJobs;
 
-            if (d->client()) {
-                d->client()->didFinishLoading(job, 0);
-                CurlCacheManager::getInstance().didFinishLoading(*job);
+    while (true) {
+        {
+            MutexLocker lock(m_networkMutex);
+
+            // Before the adds, so a job freed and a new one at its address
+            // can't get its login
+            for (auto& credentials : m_networkCredentials) {
+                if (activeJobs.contains(credentials.first))
+                    curl_easy_setopt(credentials.first->getInternal()->m_handle, CURLOPT_USERPWD, credentials.second.data());
             }
-        } else {
-            char* url = 0;
-            curl_easy_getinfo(d->m_handle, CURLINFO_EFFECTIVE_URL, &url);
-            URL tmpurl(URL(), url);
-#ifndef NDEBUG
-            fprintf(stderr, "Curl ERROR for url='%s', error: '%s'\n", url, curl_easy_strerror(msg->data.result));
-#endif
-            if (d->client()) {
-                ResourceError resourceError(tmpurl.host(), msg->data.result, String(url), String(curl_easy_strerror(msg->data.result)));
-                resourceError.setSSLErrors(d->m_sslErrors);
-                d->client()->didFail(job, resourceError);
-                CurlCacheManager::getInstance().didFail(*job);
+            m_networkCredentials.clear();
+
+            for (auto job : m_networkAdds) {
+                curl_multi_add_handle(m_networkMultiHandle, job->getInternal()->m_handle);
+                activeJobs.add(job);
+            }
+            m_networkAdds.clear();
+
+            for (auto job : m_networkRemoves) {
+                if (!activeJobs.remove(job))
+                    continue;
+                curl_multi_remove_handle(m_networkMultiHandle, job->getInternal()->m_handle);
+
+                auto event = std::make_unique<NetworkEvent>(job, NetworkEvent::Done);
+                event->result = CURLE_ABORTED_BY_CALLBACK;
+                m_threadEvents.append(WTF::move(event));
             }
+            m_networkRemoves.clear();
         }
 
-        removeFromCurl(job);
+        int runningHandles = 0;
+        curl_multi_perform(m_networkMultiHandle, &runningHandles);
+
+        while (true) {
+            int messagesInQueue;
+            CURLMsg* msg = curl_multi_info_read(m_networkMultiHandle, &messagesInQueue);
+            if (!msg)
+                break;
+            if (CURLMSG_DONE != msg->msg)
+                continue;
+
+            CURL* handle = msg->easy_handle;
+            ResourceHandle* job = 0;
+            curl_easy_getinfo(handle, CURLINFO_PRIVATE, &job);
+            if (!job || !activeJobs.remove(job))
+                continue;
+
+            auto event = std::make_unique<NetworkEvent>(job, NetworkEvent::Done);
+            event->result = msg->data.result;
+            getTransferInfo(handle, event->info);
+            m_threadEvents.append(WTF::move(event));
+
+            curl_multi_remove_handle(m_networkMultiHandle, handle);
+        }
+
+        // Hand everything from this round over in one batch.
+        if (!m_threadEvents.isEmpty()) {
+            MutexLocker lock(m_networkMutex);
+            const bool dispatchPending = !m_networkEvents.isEmpty();
+            for (auto& event : m_threadEvents)
+                m_networkEvents.append(WTF::move(event));
+            m_threadEvents.clear();
+            if (!dispatchPending)
+                callOnMainThread(dispatchNetworkEvents, this);
+        }
+
+        struct curl_waitfd wakeup;
+        wakeup.fd = m_networkWakeup[0];
+        wakeup.events = CURL_WAIT_POLLIN;
+        wakeup.revents = 0;
+        curl_multi_wait(m_networkMultiHandle, &wakeup, 1, 1000, 0);
+
+        if (wakeup.revents) {
+            char buf[64];
+            while (read(m_networkWakeup[0], buf, sizeof(buf)) > 0) { }
+        }
     }
+}
 
-    // if we had any activity, immediately select again to drain all kernel buffers
-    if (again) {
-        downloadTimerCallback();
+void ResourceHandleManager::dispatchNetworkEvents(void* data)
+{
+    ResourceHandleManager* self = static_cast<ResourceHandleManager*>(data);
+
+    // A client may spin a nested event loop, e.g. for a JS alert. Don't
+    // let the nested dispatch deliver newer events first.
+    static bool dispatching = false;
+    if (dispatching)
         return;
+    dispatching = true;
+
+    Vector<std::unique_ptr<NetworkEvent>> events;
+    events.swap(self->m_deferredEvents);
+    {
+        MutexLocker lock(self->m_networkMutex);
+        for (auto& event : self->m_networkEvents)
+            events.append(WTF::move(event));
+        self->m_networkEvents.clear();
     }
 
-    bool started = startScheduledJobs(); // new jobs might have been added in the meantime
+    for (auto& event : events) {
+        ResourceHandle* job = event->job;
+        ResourceHandleInternal* d = job->getInternal();
 
-    if (!m_downloadTimer.isActive() && (started || (runningHandles > 0)))
-        m_downloadTimer.startOneShot(pollTimeSeconds);
+        // The network thread keeps loading deferred jobs, their events
+        // wait here until they are resumed.
+        if (d->m_defersLoading && !d->m_cancelled) {
+            self->m_deferredEvents.append(WTF::move(event));
+            continue;
+        }
+
+        switch (event->type) {
+        case NetworkEvent::Header:
+            processHeader(job, event->data.data(), event->data.size(), event->info);
+            break;
+        case NetworkEvent::Data:
+            processData(job, event->data.data(), event->data.size(), event->info);
+            break;
+        case NetworkEvent::Done:
+            if (!d->m_cancelled)
+                finishJob(job, event->result, event->info);
+            curl_easy_cleanup(d->m_handle);
+            d->m_handle = 0;
+            self->jobFinished(d);
+            job->deref();
+            break;
+        }
+    }
+
+    dispatching = false;
+
+    {
+        MutexLocker lock(self->m_networkMutex);
+        if (!self->m_networkEvents.isEmpty())
+            callOnMainThread(dispatchNetworkEvents, self);
+    }
+
+    self->startScheduledJobs();
+}
+
+void ResourceHandleManager::resumeDeferredEvents()
+{
+    if (!m_deferredEvents.isEmpty())
+        callOnMainThread(dispatchNetworkEvents, this);
 }
 
 void ResourceHandleManager::setProxyInfo(const String& host,
@@ -821,7 +1249,7 @@ void ResourceHandleManager::removeFromCurl(ResourceHandle* job)
     ASSERT(d->m_handle);
     if (!d->m_handle)
         return;
-    m_runningJobs--;
+    jobFinished(d);
     curl_multi_remove_handle(m_curlMultiHandle, d->m_handle);
     curl_easy_cleanup(d->m_handle);
     d->m_handle = 0;
@@ -942,17 +1370,23 @@ void ResourceHandleManager::add(ResourceHandle* job)
     // we can be called from within curl, so to avoid re-entrancy issues
     // schedule this job to be added the next time we enter curl download loop
     job->ref();
-    m_resourceHandleList.append(job);
+    m_resourceHandleList[static_cast<unsigned>(job->firstRequest().priority())].append(job);
+    m_needsScheduling = true;
+#if PLATFORM(FLTK)
+    // The timer may be waiting on a long curl timeout.
+    m_downloadTimer.startOneShot(0); // immediately
+#else
     if (!m_downloadTimer.isActive())
         m_downloadTimer.startOneShot(0); // immediately
+#endif
 }
 
 bool ResourceHandleManager::removeScheduledJob(ResourceHandle* job)
 {
-    int size = m_resourceHandleList.size();
-    for (int i = 0; i < size; i++) {
-        if (job == m_resourceHandleList[i]) {
-            m_resourceHandleList.remove(i);
+    for (auto& list : m_resourceHandleList) {
+        size_t index = list.find(job);
+        if (index != notFound) {
+            list.remove(index);
             job->deref();
             return true;
         }
@@ -960,20 +1394,94 @@ bool ResourceHandleManager::removeScheduledJob(ResourceHandle* job)
     return false;
 }
 
+curl_socket_t ResourceHandleManager::refuseSocketCallback(void*, curlsocktype, struct curl_sockaddr*)
+{
+    return CURL_SOCKET_BAD;
+}
+
+// A DNS prefetch is a transfer that fails once the name is resolved, which
+// leaves the addresses in the share handle's DNS cache for the real request.
+void ResourceHandleManager::prefetchDNS(const String& hostname, int port, std::function<void()> completion)
+{
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        completion();
+        return;
+    }
+
+    String url = "http://" + hostname + ":" + String::number(port) + "/";
+
+    curl_easy_setopt(handle, CURLOPT_URL, url.latin1().data());
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_curlShareHandle);
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 60 * 5); // 5 minutes
+    curl_easy_setopt(handle, CURLOPT_PROXY, "");
+    curl_easy_setopt(handle, CURLOPT_OPENSOCKETFUNCTION, refuseSocketCallback);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1);
+
+    m_dnsPrefetches.set(handle, WTF::move(completion));
+    curl_multi_add_handle(m_curlMultiHandle, handle);
+
+    if (!m_downloadTimer.isActive())
+        m_downloadTimer.startOneShot(0);
+}
+
+bool ResourceHandleManager::usesProxy() const
+{
+    if (!m_proxy.isEmpty())
+        return true;
+
+    // Curl picks these up on its own
+    return getenv("http_proxy") || getenv("https_proxy") || getenv("HTTPS_PROXY") || getenv("all_proxy") || getenv("ALL_PROXY");
+}
+
+void ResourceHandleManager::setMaxConnections(unsigned total, unsigned perHost)
+{
+    m_maxRunningJobs = std::max(total, 1u);
+    m_maxJobsPerHost = std::max(perHost, 1u);
+    m_needsScheduling = true;
+    m_downloadTimer.startOneShot(0);
+}
+
+// Starts the most important jobs first, oldest first within a priority.
+// Jobs whose host is at its limit wait without holding up the others.
 bool ResourceHandleManager::startScheduledJobs()
 {
-    // TODO: Create a separate stack of jobs for each domain.
+    // Everything startable is started below; finished jobs and add() set
+    // this again when more can run.
+    m_needsScheduling = false;
 
     bool started = false;
-    while (!m_resourceHandleList.isEmpty() && m_runningJobs < maxRunningJobs) {
-        ResourceHandle* job = m_resourceHandleList[0];
-        m_resourceHandleList.remove(0);
-        startJob(job);
-        started = true;
+    for (int priority = resourceLoadPriorityCount - 1; priority >= 0; --priority) {
+        Vector<ResourceHandle*>& list = m_resourceHandleList[priority];
+        for (size_t i = 0; i < list.size() && m_runningJobs < m_maxRunningJobs; ) {
+            ResourceHandle* job = list[i];
+            const String& host = job->firstRequest().url().host();
+            if (!host.isEmpty() && m_hostJobs.get(host) >= m_maxJobsPerHost) {
+                ++i;
+                continue;
+            }
+
+            list.remove(i);
+            startJob(job);
+            started = true;
+        }
     }
     return started;
 }
 
+void ResourceHandleManager::jobFinished(ResourceHandleInternal* d)
+{
+    m_runningJobs--;
+    m_needsScheduling = true;
+
+    if (!d->m_connectionHost.isEmpty()) {
+        auto it = m_hostJobs.find(d->m_connectionHost);
+        if (it != m_hostJobs.end() && !--it->value)
+            m_hostJobs.remove(it);
+        d->m_connectionHost = String();
+    }
+}
+
 void ResourceHandleManager::dispatchSynchronousJob(ResourceHandle* job)
 {
     URL kurl = job->firstRequest().url();
@@ -984,6 +1492,12 @@ void ResourceHandleManager::dispatchSynchronousJob(ResourceHandle* job)
         return;
     }
 
+    if (kurl.isLocalFile()) {
+        handleFileURL(job);
+        job->deref();
+        return;
+    }
+
     ResourceHandleInternal* handle = job->getInternal();
 
     // If defersLoading is true and we call curl_easy_perform
@@ -991,7 +1505,9 @@ void ResourceHandleManager::dispatchSynchronousJob(ResourceHandle* job)
     // and we would assert so force defersLoading to be false.
     handle->m_defersLoading = false;
 
-    initializeHandle(job);
+    // Performed right here on the main thread, so the events can't go
+    // through the network thread's queue
+    initializeHandle(job, false);
 
     // curl_easy_perform blocks until the transfert is finished.
     CURLcode ret =  curl_easy_perform(handle->m_handle);
@@ -1023,9 +1539,29 @@ void ResourceHandleManager::startJob(ResourceHandle* job)
         return;
     }
 
-    initializeHandle(job);
+    if (url.isLocalFile()) {
+        handleFileURL(job);
+        job->deref();
+        return;
+    }
+
+    initializeHandle(job, m_useNetworkThread);
 
     m_runningJobs++;
+    ResourceHandleInternal* d = job->getInternal();
+    d->m_connectionHost = url.host();
+    if (!d->m_connectionHost.isEmpty())
+        m_hostJobs.add(d->m_connectionHost, 0).iterator->value++;
+
+    if (m_useNetworkThread) {
+        {
+            MutexLocker lock(m_networkMutex);
+            m_networkAdds.append(job);
+        }
+        wakeNetworkThread();
+        return;
+    }
+
     CURLMcode ret = curl_multi_add_handle(m_curlMultiHandle, job->getInternal()->m_handle);
     // don't call perform, because events must be async
     // timeout will occur and do curl_multi_perform
@@ -1076,7 +1612,7 @@ void ResourceHandleManager::applyAuthenticationToRequest(ResourceHandle* handle,
     curl_easy_setopt(d->m_handle, CURLOPT_USERPWD, userpass.utf8().data());
 }
 
-void ResourceHandleManager::initializeHandle(ResourceHandle* job)
+void ResourceHandleManager::initializeHandle(ResourceHandle* job, bool threaded)
 {
     static const int allowedProtocols = CURLPROTO_FILE | CURLPROTO_FTP | CURLPROTO_FTPS | CURLPROTO_HTTP | CURLPROTO_HTTPS;
     URL url = job->firstRequest().url();
@@ -1087,20 +1623,11 @@ void ResourceHandleManager::initializeHandle(ResourceHandle* job)
     ResourceHandleInternal* d = job->getInternal();
     String urlString = url.string();
 
-    if (url.isLocalFile()) {
-        // Remove any query part sent to a local file.
-        if (!url.query().isEmpty()) {
-            // By setting the query to a null string it'll be removed.
-            url.setQuery(String());
-            urlString = url.string();
-        }
-        // Determine the MIME type based on the path.
-        d->m_response.setMimeType(MIMETypeRegistry::getMIMETypeForPath(url));
-    }
-
     d->m_handle = curl_easy_init();
+    d->m_threaded = threaded;
 
-    if (d->m_defersLoading) {
+    // Deferring is done when delivering the network thread's events.
+    if (d->m_defersLoading && !threaded) {
         CURLcode error = curl_easy_pause(d->m_handle, CURLPAUSE_ALL);
         // If we did not pause the handle, we would ASSERT in the
         // header callback. So just assert here.
@@ -1120,9 +1647,15 @@ void ResourceHandleManager::initializeHandle(ResourceHandle* job)
     curl_easy_setopt(d->m_handle, CURLOPT_SSL_VERIFYHOST, 2L);
     curl_easy_setopt(d->m_handle, CURLOPT_PRIVATE, job);
     curl_easy_setopt(d->m_handle, CURLOPT_ERRORBUFFER, m_curlErrorBuffer);
-    curl_easy_setopt(d->m_handle, CURLOPT_WRITEFUNCTION, writeCallback);
+    if (threaded) {
+        curl_easy_setopt(d->m_handle, CURLOPT_WRITEFUNCTION, networkWriteCallback);
+        curl_easy_setopt(d->m_handle, CURLOPT_HEADERFUNCTION, networkHeaderCallback);
+        curl_easy_setopt(d->m_handle, CURLOPT_NOSIGNAL, 1);
+    } else {
+        curl_easy_setopt(d->m_handle, CURLOPT_WRITEFUNCTION, writeCallback);
+        curl_easy_setopt(d->m_handle, CURLOPT_HEADERFUNCTION, headerCallback);
+    }
     curl_easy_setopt(d->m_handle, CURLOPT_WRITEDATA, job);
-    curl_easy_setopt(d->m_handle, CURLOPT_HEADERFUNCTION, headerCallback);
     curl_easy_setopt(d->m_handle, CURLOPT_WRITEHEADER, job);
     curl_easy_setopt(d->m_handle, CURLOPT_AUTOREFERER, 1);
     curl_easy_setopt(d->m_handle, CURLOPT_FOLLOWLOCATION, 1);
@@ -1152,8 +1685,9 @@ void ResourceHandleManager::initializeHandle(ResourceHandle* job)
     d->m_url = fastStrDup(urlString.latin1().data());
     curl_easy_setopt(d->m_handle, CURLOPT_URL, d->m_url);
 
-    if (m_cookieJarFileName)
-        curl_easy_setopt(d->m_handle, CURLOPT_COOKIEJAR, m_cookieJarFileName);
+    // Cookies live in the share handle, the cookie store writes the file.
+    // An empty name only turns on the cookie engine.
+    curl_easy_setopt(d->m_handle, CURLOPT_COOKIEFILE, "");
 
     struct curl_slist* headers = 0;
     if (job->firstRequest().httpHeaderFields().size() > 0) {
@@ -1238,24 +1772,10 @@ void ResourceHandleManager::initializeHandle(ResourceHandle* job)
 
 void ResourceHandleManager::initCookieSession()
 {
-    // Curl saves both persistent cookies, and session cookies to the cookie file.
-    // The session cookies should be deleted before starting a new session.
-
-    CURL* curl = curl_easy_init();
-
-    if (!curl)
-        return;
-
-    curl_easy_setopt(curl, CURLOPT_SHARE, m_curlShareHandle);
-
-    if (m_cookieJarFileName) {
-        curl_easy_setopt(curl, CURLOPT_COOKIEFILE, m_cookieJarFileName);
-        curl_easy_setopt(curl, CURLOPT_COOKIEJAR, m_cookieJarFileName);
-    }
-
-    curl_easy_setopt(curl, CURLOPT_COOKIESESSION, 1);
-
-    curl_easy_cleanup(curl);
+    // Loads the persistent cookies into the share handle. Session cookies
+    // are not kept across sessions.
+    m_cookieStore = nullptr;
+    m_cookieStore = std::make_unique<CurlCookieStore>(m_cookieJarFileName, m_curlShareHandle);
 }
 
 void ResourceHandleManager::cancel(ResourceHandle* job)
@@ -1265,6 +1785,18 @@ void ResourceHandleManager::cancel(ResourceHandle* job)
 
     ResourceHandleInternal* d = job->getInternal();
     d->m_cancelled = true;
+
+    if (m_useNetworkThread) {
+        if (d->m_handle) {
+            {
+                MutexLocker lock(m_networkMutex);
+                m_networkRemoves.append(job);
+            }
+            wakeNetworkThread();
+        }
+        return;
+    }
+
     if (!m_downloadTimer.isActive())
         m_downloadTimer.startOneShot(0); // immediately
 }
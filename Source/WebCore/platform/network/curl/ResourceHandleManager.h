@@ -28,7 +28,9 @@
 #ifndef ResourceHandleManager_h
 #define ResourceHandleManager_h
 
+#include "CurlCookieStore.h"
 #include "Frame.h"
+#include "ResourceLoadPriority.h"
 #include "Timer.h"
 #include "ResourceHandleClient.h"
 
@@ -38,12 +40,18 @@
 #endif
 
 #include <curl/curl.h>
+#include <functional>
+#include <memory>
+#include <wtf/HashMap.h>
+#include <wtf/Threading.h>
 #include <wtf/Vector.h>
 #include <wtf/text/CString.h>
 #include <wtf/text/WTFString.h>
 
 namespace WebCore {
 
+struct NetworkEvent;
+
 class ResourceHandleManager {
 public:
     enum ProxyType {
@@ -61,6 +69,7 @@ public:
 
     void setCookieJarFileName(const char* cookieJarFileName);
     const char* getCookieJarFileName() const;
+    CurlCookieStore& cookieStore() { return *m_cookieStore; }
 
     void dispatchSynchronousJob(ResourceHandle*);
 
@@ -73,32 +82,88 @@ public:
                       const String& username = "",
                       const String& password = "");
 
+    // Run the transfers on a separate network thread. Must be enabled
+    // before anything is loaded, and cannot be disabled afterwards.
+    void enableNetworkThread();
+    bool usesNetworkThread() const { return m_useNetworkThread; }
+    void resumeDeferredEvents();
+
+    // Sets the login curl answers authentication with, on the thread that
+    // owns the job's handle
+    void setCredentials(ResourceHandle*, const String& userpass);
+
+    // Resolves hostname into the shared DNS cache, without connecting
+    void prefetchDNS(const String& hostname, int port, std::function<void()> completion);
+    bool usesProxy() const;
+
+    // Limits on parallel transfers, in total and to a single host
+    void setMaxConnections(unsigned total, unsigned perHost);
+
 private:
     ResourceHandleManager();
     ~ResourceHandleManager();
     void downloadTimerCallback();
+    void processCompletedJobs();
+#if PLATFORM(FLTK)
+    static int socketCallback(CURL*, curl_socket_t, int, void*, void*);
+    static int timerCallback(CURLM*, long, void*);
+    static void socketActivity(int, void*);
+#endif
     void removeFromCurl(ResourceHandle*);
     bool removeScheduledJob(ResourceHandle*);
     void startJob(ResourceHandle*);
     bool startScheduledJobs();
+    void jobFinished(ResourceHandleInternal*);
     void applyAuthenticationToRequest(ResourceHandle*, ResourceRequest&);
 
-    void initializeHandle(ResourceHandle*);
+    // A threaded handle runs on the network thread and queues its events
+    void initializeHandle(ResourceHandle*, bool threaded);
 
     void initCookieSession();
 
+    void networkThread();
+    void wakeNetworkThread();
+    static void dispatchNetworkEvents(void*);
+    static size_t networkHeaderCallback(char*, size_t, size_t, void*);
+    static size_t networkWriteCallback(void*, size_t, size_t, void*);
+    static curl_socket_t refuseSocketCallback(void*, curlsocktype, struct curl_sockaddr*);
+
     Timer m_downloadTimer;
     CURLM* m_curlMultiHandle;
     CURLSH* m_curlShareHandle;
+#if PLATFORM(FLTK)
+    int m_epollFd;
+#endif
     char* m_cookieJarFileName;
+    std::unique_ptr<CurlCookieStore> m_cookieStore;
     char m_curlErrorBuffer[CURL_ERROR_SIZE];
-    Vector<ResourceHandle*> m_resourceHandleList;
+    // Jobs waiting to start, one queue per ResourceLoadPriority
+    Vector<ResourceHandle*> m_resourceHandleList[resourceLoadPriorityCount];
+    bool m_needsScheduling;
+    HashMap<String, unsigned> m_hostJobs;
+    unsigned m_maxRunningJobs;
+    unsigned m_maxJobsPerHost;
     const CString m_certificatePath;
-    int m_runningJobs;
+    unsigned m_runningJobs;
+    HashMap<CURL*, std::function<void()>> m_dnsPrefetches;
     
     String m_proxy;
     ProxyType m_proxyType;
 
+    bool m_useNetworkThread;
+    CURLM* m_networkMultiHandle;
+    int m_networkWakeup[2];
+    Mutex m_networkMutex;
+    // Protected by m_networkMutex
+    Vector<ResourceHandle*> m_networkAdds;
+    Vector<ResourceHandle*> m_networkRemoves;
+    Vector<std::pair<ResourceHandle*, CString>> m_networkCredentials;
+    Vector<std::unique_ptr<NetworkEvent>> m_networkEvents;
+    // Only touched by the network thread
+    Vector<std::unique_ptr<NetworkEvent>> m_threadEvents;
+    // Only touched by the main thread
+    Vector<std::unique_ptr<NetworkEvent>> m_deferredEvents;
+
 #ifndef NDEBUG
     FILE* m_logFile;
 #endif
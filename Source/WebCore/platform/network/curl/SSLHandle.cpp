@@ -35,6 +35,8 @@
 #include <openssl/ssl.h>
 #include <openssl/x509_vfy.h>
 #include <wtf/ListHashSet.h>
+#include <wtf/MainThread.h>
+#include <wtf/Threading.h>
 #include <wtf/text/CString.h>
 
 int fl_check_cert(const String &str, const String &host);
@@ -142,6 +144,32 @@ static bool pemData(X509_STORE_CTX* ctx, String &out)
     return true;
 }
 
+// The embedder may show UI to decide, so always ask from the main thread.
+static int checkCertificate(const String& certdata, const String& host)
+{
+    if (isMainThread())
+        return fl_check_cert(certdata, host);
+
+    Mutex mutex;
+    ThreadCondition condition;
+    bool done = false;
+    int ret = 0;
+
+    callOnMainThread([&] {
+        ret = fl_check_cert(certdata, host);
+
+        MutexLocker lock(mutex);
+        done = true;
+        condition.signal();
+    });
+
+    MutexLocker lock(mutex);
+    while (!done)
+        condition.wait(mutex);
+
+    return ret;
+}
+
 static int certVerifyCallback(int ok, X509_STORE_CTX* ctx)
 {
     // whether the verification of the certificate in question was passed (preverify_ok=1) or not (preverify_ok=0)
@@ -151,7 +179,7 @@ static int certVerifyCallback(int ok, X509_STORE_CTX* ctx)
     SSL* ssl = reinterpret_cast<SSL*>(X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx()));
     SSL_CTX* sslctx = SSL_get_SSL_CTX(ssl);
     ResourceHandle* job = reinterpret_cast<ResourceHandle*>(SSL_CTX_get_app_data(sslctx));
-    String host = job->firstRequest().url().host();
+    String host = job->firstRequest().url().host().isolatedCopy();
     ResourceHandleInternal* d = job->getInternal();
 
     d->m_sslErrors = sslCertificateFlag(err);
@@ -160,7 +188,7 @@ static int certVerifyCallback(int ok, X509_STORE_CTX* ctx)
     if (!pemData(ctx, certdata))
         return 0;
 
-    return fl_check_cert(certdata, host);
+    return checkCertificate(certdata, host);
 }
 
 static CURLcode sslctxfun(CURL* curl, void* sslctx, void* parm)
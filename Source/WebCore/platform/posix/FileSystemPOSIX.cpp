@@ -83,6 +83,8 @@ PlatformFileHandle openFile(const String& path, FileOpenMode mode)
         platformFlag |= O_RDONLY;
     else if (mode == OpenForWrite)
         platformFlag |= (O_WRONLY | O_CREAT | O_TRUNC);
+    else if (mode == OpenForAppend)
+        platformFlag |= (O_WRONLY | O_CREAT | O_APPEND);
     return open(fsRep.data(), platformFlag, 0666);
 }
 
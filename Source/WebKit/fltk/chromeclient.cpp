@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "chromeclient.h"
 #include "webviewpriv.h"
 
+#include <cairo-xlib.h>
 #include <FL/fl_ask.H>
 #include <FL/fl_draw.H>
 #include <FL/Fl_File_Chooser.H>
@@ -204,7 +205,15 @@ static const char *shortenJS(const char * const url) {
 	return buf;
 }
 
+// Headless views have no display for dialogs. Alerts go to stderr,
+// confirms and prompts are declined.
 void FlChromeClient::runJavaScriptAlert(Frame *f, const String &s) {
+	if (view->isNoGui()) {
+		fprintf(stderr, "<%s> %s\n", f->document()->baseURI().string().utf8().data(),
+			s.utf8().data());
+		return;
+	}
+
 	fl_message_title("Javascript alert");
 	if (view->priv->quietdiags) {
 		fl_alert("%s", s.utf8().data());
@@ -215,6 +224,9 @@ void FlChromeClient::runJavaScriptAlert(Frame *f, const String &s) {
 }
 
 bool FlChromeClient::runJavaScriptConfirm(Frame *f, const String &s) {
+	if (view->isNoGui())
+		return false;
+
 	fl_message_title("Javascript confirm");
 	if (view->priv->quietdiags) {
 		return fl_choice("%s", fl_cancel, fl_ok, NULL,
@@ -229,6 +241,9 @@ bool FlChromeClient::runJavaScriptConfirm(Frame *f, const String &s) {
 bool FlChromeClient::runJavaScriptPrompt(Frame *f, const String &s,
 		const String &def, String &out) {
 
+	if (view->isNoGui())
+		return false;
+
 	fl_message_title("Javascript prompt");
 	const char *res;
 
@@ -277,27 +292,81 @@ IntRect FlChromeClient::windowResizerRect() const {
 	return IntRect();
 }
 
+// Only the window is out of date, the pixmap has it already
 void FlChromeClient::invalidateRootView(const IntRect &rect) {
 
-	if (rect.width() < 2)
-		view->redraw();
-	else
-		view->damage(FL_DAMAGE_EXPOSE, rect.x() + view->x(),
-				rect.y() + view->y(),
-				rect.width(), rect.height());
+	IntRect r = rect;
+	r.intersect(IntRect(0, 0, view->w(), view->h()));
+	if (r.isEmpty())
+		return;
+
+	view->priv->present.unite(r);
+	scheduleredraw(view);
 }
 
 void FlChromeClient::invalidateContentsAndRootView(const IntRect &rect) {
-	invalidateRootView(rect);
+
+	// Antialiased edges, like the caret's, can bleed a pixel outside
+	IntRect r = rect;
+	r.inflate(1);
+	r.intersect(IntRect(0, 0, view->w(), view->h()));
+	if (r.isEmpty())
+		return;
+
+	view->priv->dirty.unite(r);
+	scheduleredraw(view);
 }
 
 void FlChromeClient::invalidateContentsForSlowScroll(const IntRect &rect) {
-	invalidateRootView(rect);
+	invalidateContentsAndRootView(rect);
 }
 
-void FlChromeClient::scroll(const IntSize&, const IntRect &rect,
-		const IntRect&) {
-	invalidateRootView(rect);
+// Move what's already painted and only paint the strip that scrolled in.
+// WebCore takes the slow path itself for fixed-position content.
+void FlChromeClient::scroll(const IntSize &delta, const IntRect &rect,
+		const IntRect &clip) {
+
+	privatewebview * const priv = view->priv;
+
+	IntRect area = intersection(rect, clip);
+	area.intersect(IntRect(0, 0, view->w(), view->h()));
+	if (area.isEmpty())
+		return;
+
+	if (view->isNoGui() || !priv->cairo ||
+		abs(delta.width()) >= area.width() ||
+		abs(delta.height()) >= area.height()) {
+		invalidateContentsAndRootView(area);
+		return;
+	}
+
+	// The part that stays visible, and where it ends up
+	IntRect src = area;
+	src.move(-delta);
+	src.intersect(area);
+	IntRect dst = src;
+	dst.move(delta);
+
+	cairo_surface_flush(priv->cairosurf);
+	XCopyArea(fl_display, priv->cairopix, priv->cairopix, priv->pixgc,
+			src.x(), src.y(), src.width(), src.height(),
+			dst.x(), dst.y());
+	cairo_surface_mark_dirty_rectangle(priv->cairosurf,
+			dst.x(), dst.y(), dst.width(), dst.height());
+
+	// Damage not yet painted moves with the contents
+	Region moved = intersect(priv->dirty, Region(area));
+	priv->dirty.subtract(area);
+	moved.translate(delta);
+	moved.intersect(dst);
+	priv->dirty.unite(moved);
+
+	Region strip(area);
+	strip.subtract(dst);
+	priv->dirty.unite(strip);
+
+	priv->present.unite(area);
+	scheduleredraw(view);
 }
 
 IntPoint FlChromeClient::screenToRootView(const IntPoint &p) const {
@@ -319,6 +388,8 @@ void FlChromeClient::scrollbarsModeDidChange() const {
 }
 
 void FlChromeClient::setCursor(const WebCore::Cursor &cursor) {
+	if (view->isNoGui())
+		return;
 	fl_cursor((Fl_Cursor) cursor.platformCursor());
 }
 
@@ -382,6 +453,9 @@ void FlChromeClient::reachedApplicationCacheOriginQuota(SecurityOrigin*,
 }
 
 void FlChromeClient::runOpenPanel(Frame *f, PassRefPtr<FileChooser> chooser) {
+	if (view->isNoGui())
+		return;
+
 	bool multi = false;
 	static const char *prevdir = NULL;
 	const char *dir = prevdir;
@@ -0,0 +1,206 @@
+/*
+WebkitFLTK
+Copyright (C) 2014 Lauri Kasanen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, version 3 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include "contentblocker.h"
+#include "webkit.h"
+
+#include <CompiledContentExtension.h>
+#include <ContentExtensionCompiler.h>
+#include <wtf/SHA1.h>
+#include <wtf/text/WTFString.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace WTF;
+using namespace WebCore;
+using namespace WebCore::ContentExtensions;
+
+// A compiled file is this header, the DFA bytecode and the actions.
+// Native endian, it's only meant for the machine that compiled it.
+// The interpreter follows jumps in the bytecode unchecked, so both
+// sections are covered by a SHA-1.
+struct blockerheader {
+	char magic[4];
+	uint32_t version;
+	uint32_t bytecodelen;
+	uint32_t actionslen;
+	SHA1::Digest digest;
+};
+
+static const char blockermagic[4] = { 'W', 'K', 'C', 'B' };
+static const uint32_t blockerversion = 2;
+
+static SHA1::Digest blockerdigest(const uint8_t *bytecode, const uint32_t bytecodelen,
+					const uint8_t *actions, const uint32_t actionslen) {
+	SHA1 sha1;
+	sha1.addBytes(bytecode, bytecodelen);
+	sha1.addBytes(actions, actionslen);
+
+	SHA1::Digest digest;
+	sha1.computeHash(digest);
+	return digest;
+}
+
+WebCore::UserContentController *usercontent() {
+	static RefPtr<UserContentController> controller = UserContentController::create();
+	return controller.get();
+}
+
+// The interpreter runs straight from the page cache, nothing is copied.
+class mappedblocker final: public CompiledContentExtension {
+public:
+	static RefPtr<mappedblocker> create(const char *path);
+
+	virtual ~mappedblocker() {
+		munmap((void *) map, len);
+	}
+
+	virtual const DFABytecode *bytecode() const override {
+		return map + sizeof(blockerheader);
+	}
+	virtual unsigned bytecodeLength() const override {
+		return header()->bytecodelen;
+	}
+	virtual const SerializedActionByte *actions() const override {
+		return map + sizeof(blockerheader) + header()->bytecodelen;
+	}
+	virtual unsigned actionsLength() const override {
+		return header()->actionslen;
+	}
+
+private:
+	mappedblocker(const uint8_t *map, const size_t len): map(map), len(len) {}
+
+	const blockerheader *header() const {
+		return (const blockerheader *) map;
+	}
+
+	const uint8_t * const map;
+	const size_t len;
+};
+
+RefPtr<mappedblocker> mappedblocker::create(const char *path) {
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	if (fstat(fd, &st) || (size_t) st.st_size < sizeof(blockerheader)) {
+		close(fd);
+		return nullptr;
+	}
+
+	void * const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return nullptr;
+
+	const blockerheader * const hdr = (const blockerheader *) map;
+	const uint8_t * const bytecode = (const uint8_t *) map + sizeof(blockerheader);
+	if (memcmp(hdr->magic, blockermagic, sizeof(blockermagic)) ||
+		hdr->version != blockerversion ||
+		sizeof(blockerheader) + (uint64_t) hdr->bytecodelen + hdr->actionslen !=
+			(uint64_t) st.st_size ||
+		blockerdigest(bytecode, hdr->bytecodelen, bytecode + hdr->bytecodelen,
+				hdr->actionslen) != hdr->digest) {
+		munmap(map, st.st_size);
+		return nullptr;
+	}
+
+	return adoptRef(new mappedblocker((const uint8_t *) map, st.st_size));
+}
+
+class compileclient final: public ContentExtensionCompilationClient {
+public:
+	virtual void writeBytecode(Vector<DFABytecode> &&data) override {
+		bytecode.appendVector(data);
+	}
+	virtual void writeActions(Vector<SerializedActionByte> &&data) override {
+		actions.appendVector(data);
+	}
+	virtual void finalize() override {}
+
+	Vector<DFABytecode> bytecode;
+	Vector<SerializedActionByte> actions;
+};
+
+int wk_compile_content_blocker(const char *json, const char *file) {
+
+	compileclient client;
+	const std::error_code err = compileRuleList(client, String::fromUTF8(json));
+	if (err) {
+		fprintf(stderr, "Content blocker: %s\n", err.message().c_str());
+		return 1;
+	}
+
+	blockerheader hdr;
+	memcpy(hdr.magic, blockermagic, sizeof(blockermagic));
+	hdr.version = blockerversion;
+	hdr.bytecodelen = client.bytecode.size();
+	hdr.actionslen = client.actions.size();
+	hdr.digest = blockerdigest(client.bytecode.data(), hdr.bytecodelen,
+					client.actions.data(), hdr.actionslen);
+
+	// Write aside and rename, a mapped file must never change under us
+	char *tmp;
+	if (asprintf(&tmp, "%s.tmp", file) < 0)
+		return 1;
+
+	FILE *f = fopen(tmp, "w");
+	if (!f) {
+		free(tmp);
+		return 1;
+	}
+
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	if (hdr.bytecodelen)
+		ok &= fwrite(client.bytecode.data(), hdr.bytecodelen, 1, f) == 1;
+	if (hdr.actionslen)
+		ok &= fwrite(client.actions.data(), hdr.actionslen, 1, f) == 1;
+	ok &= !fclose(f);
+
+	if (!ok || rename(tmp, file)) {
+		unlink(tmp);
+		free(tmp);
+		return 1;
+	}
+
+	free(tmp);
+	return 0;
+}
+
+int wk_load_content_blocker(const char *file) {
+
+	RefPtr<mappedblocker> blocker = mappedblocker::create(file);
+	if (!blocker)
+		return 1;
+
+	usercontent()->addUserContentExtension(file, blocker);
+	return 0;
+}
+
+void wk_unload_content_blockers() {
+	usercontent()->removeAllUserContentExtensions();
+}
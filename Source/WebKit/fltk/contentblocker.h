@@ -0,0 +1,28 @@
+/*
+WebkitFLTK
+Copyright (C) 2014 Lauri Kasanen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, version 3 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef contentblocker_h
+#define contentblocker_h
+
+#include <platform/PlatformExportMacros.h>
+#include <wtf/text/WTFString.h>
+#include <UserContentController.h>
+
+// Shared by all views, holds the loaded content blockers
+WebCore::UserContentController *usercontent();
+
+#endif
@@ -19,15 +19,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "download.h"
 
+#include <HTTPHeaderNames.h>
 #include <wtf/text/Base64.h>
 #include <wtf/text/CString.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace WTF;
 using namespace WebCore;
 
 extern void (*downloadfunc)(const char *url, const char *file);
 extern void (*downloadrefreshfunc)();
+extern unsigned downloadconnections;
+
+// Smaller parts aren't worth a connection
+static const long long minsegment = 1024 * 1024;
 
 static void saveData(const char *file, const char *data, const unsigned size) {
 	FILE *f = fopen(file, "w");
@@ -66,15 +76,52 @@ static unsigned handleData(const char *url, const char *file) {
 	return 0;
 }
 
+// A byte range over its own connection
+class download::segment: public CurlDownloadListener {
+public:
+	segment(download *parent, const long long start, const long long end,
+		const long long done): parent(parent), start(start), end(end),
+		done(done), finished(false), failed(false) {}
+
+	void didReceiveResponse() override {
+		parent->segmentresponse(this);
+	}
+
+	void didReceiveDataOfLength(int size) override {
+		done += size;
+		parent->segmentdata(size);
+	}
+
+	void didFinish() override {
+		finished = true;
+		parent->segmentdone();
+	}
+
+	void didFail() override {
+		failed = true;
+		parent->fail();
+	}
+
+	download * const parent;
+	CurlDownload curl;
+	const long long start;
+	long long end; // inclusive, -1 for the rest
+	long long done;
+	bool finished, failed;
+};
+
 download::download(const char *url, const char *file,
 			const ResourceRequest *req) {
 	this->url = strdup(url);
 	this->file = strdup(file);
-	time = ::time(NULL);
+	time = lastsave = ::time(NULL);
 	received = 0;
 	size = -1;
 	failed = finished = false;
 	isData = false;
+	ranges = stale = false;
+	probe = NULL;
+	fd = -1;
 
 	// Is it a data: url? data:image/octet-stream;base64,iVBORw0KG
 	if (!strncmp(url, "data:", 5)) {
@@ -83,45 +130,194 @@ download::download(const char *url, const char *file,
 		size = received = handleData(url, file);
 
 		if (size)
-			didFinish();
+			finish();
 		else
-			didFail();
+			fail();
 
 		return;
 	}
 
-	curl.init(this, URL(ParsedURLString, this->url));
-
+	hasreq = req;
 	if (req)
-		curl.addHeaders(*req);
+		this->req = *req;
+
+	partname = String(String::fromUTF8(file) + ".part").utf8();
+	statename = String(String::fromUTF8(file) + ".part.state").utf8();
+
+	fd = open(partname.data(), O_WRONLY | O_CREAT, 0644);
+	if (fd < 0) {
+		fail();
+		return;
+	}
 
-	curl.setDestination(file);
+	if (loadstate()) {
+		ranges = true;
 
-	curl.start();
+		bool all = true;
+		for (const segment *s: segments)
+			all &= s->finished;
+		if (all)
+			finish();
+		return;
+	}
+
+	// Ask for the first byte. A server that takes ranges says how big the
+	// file is, and the rest is split. One that doesn't sends it all here.
+	if (ftruncate(fd, 0)) {
+		fail();
+		return;
+	}
+	unlink(statename.data());
+	addsegment(0, 0, 0);
+	probe = segments[0];
 }
 
 download::~download() {
+	for (segment *s: segments)
+		delete s;
+	if (fd >= 0)
+		close(fd);
+
 	free((char *) url);
 	free((char *) file);
 }
 
-void download::didReceiveResponse() {
-	if (isData)
+void download::addsegment(const long long start, const long long end,
+				const long long done) {
+
+	segment * const s = new segment(this, start, end, done);
+	segments.push_back(s);
+
+	if (end >= 0 && start + done > end) {
+		s->finished = true;
 		return;
+	}
 
-	const ResourceResponse &res = curl.getResponse();
-	size = res.expectedContentLength();
+	s->curl.init(s, URL(ParsedURLString, url));
+	if (hasreq)
+		s->curl.addHeaders(req);
+	s->curl.setRange(start + done, end, start + done ? validator : String());
+	s->curl.setOutputFile(fd, start + done);
+	s->curl.start();
 }
 
-void download::didReceiveDataOfLength(int size) {
+void download::split(const long long total) {
 
-	received += size;
+	size = total;
+
+	// Unknown size, the rest in one go
+	if (total < 0) {
+		addsegment(1, -1, 0);
+		return;
+	}
+	if (total <= 1)
+		return;
+
+	// Reserve it all now, the segments write all over
+	if (posix_fallocate(fd, 0, total) && ftruncate(fd, total)) {
+		fail();
+		return;
+	}
+
+	const long long rest = total - 1;
+	long long num = rest / minsegment;
+	if (num > downloadconnections)
+		num = downloadconnections;
+	if (num < 1)
+		num = 1;
+
+	const long long len = rest / num;
+	for (long long i = 0; i < num; i++) {
+		const long long start = 1 + i * len;
+		const long long end = i == num - 1 ? total - 1 : start + len - 1;
+		addsegment(start, end, 0);
+	}
+}
+
+void download::segmentresponse(segment *s) {
+
+	const ResourceResponse res = s->curl.getResponse();
+	const int code = res.httpStatusCode();
+
+	if (s != probe) {
+		if (code != 206)
+			stale = true;
+		return;
+	}
+
+	// An empty file, the probe finishes with nothing
+	if (code == 416) {
+		size = 0;
+		return;
+	}
+
+	if (code != 206) {
+		// No ranges, the probe gets it all
+		s->end = -1;
+		size = res.expectedContentLength();
+		return;
+	}
+
+	// Weak ETags can't be used with If-Range
+	validator = res.httpHeaderField(HTTPHeaderName::ETag);
+	if (validator.startsWith("W/"))
+		validator = String();
+	if (validator.isEmpty())
+		validator = res.httpHeaderField(HTTPHeaderName::LastModified);
+
+	// Content-Range: bytes 0-0/total, or */ if unknown
+	const String range = res.httpHeaderField(String("Content-Range"));
+	const size_t slash = range.find('/');
+	bool ok = false;
+	long long total = -1;
+	if (slash != notFound)
+		total = range.substring(slash + 1).toInt64(&ok);
+	if (!ok)
+		total = -1;
+
+	ranges = true;
+	split(total);
+	savestate();
+}
+
+void download::segmentdata(const int len) {
+
+	received += len;
+
+	const time_t now = ::time(NULL);
+	if (now != lastsave) {
+		savestate();
+		lastsave = now;
+	}
 
 	if (downloadrefreshfunc)
 		downloadrefreshfunc();
 }
 
-void download::didFinish() {
+void download::segmentdone() {
+
+	for (const segment *s: segments) {
+		if (!s->finished)
+			return;
+	}
+
+	finish();
+}
+
+void download::finish() {
+
+	if (finished || failed)
+		return;
+
+	if (!isData) {
+		close(fd);
+		fd = -1;
+		if (rename(partname.data(), file)) {
+			fail();
+			return;
+		}
+		unlink(statename.data());
+	}
 
 	finished = true;
 
@@ -131,19 +327,126 @@ void download::didFinish() {
 		downloadrefreshfunc();
 }
 
-void download::didFail() {
+void download::fail() {
+
+	if (finished || failed)
+		return;
 	failed = true;
+
+	for (segment *s: segments) {
+		if (!s->finished && !s->failed)
+			s->curl.cancel();
+	}
+
+	// The server's file changed, the part is no good
+	if (stale) {
+		unlink(statename.data());
+		unlink(partname.data());
+	} else {
+		savestate();
+	}
+
+	if (downloadrefreshfunc)
+		downloadrefreshfunc();
 }
 
 void download::stop() {
 	if (isData)
 		return;
 
-	curl.cancel();
-	failed = true;
+	fail();
+}
 
-	if (downloadrefreshfunc)
-		downloadrefreshfunc();
+static bool readline(FILE *f, char **line, size_t *len) {
+	const ssize_t got = getline(line, len, f);
+	if (got <= 0)
+		return false;
+	if ((*line)[got - 1] == '\n')
+		(*line)[got - 1] = '\0';
+	return true;
+}
+
+// The state file: url, validator, size, and a start end done line per
+// segment. Only what is already on disk is counted as done.
+bool download::loadstate() {
+
+	FILE *f = fopen(statename.data(), "r");
+	if (!f)
+		return false;
+
+	char *line = NULL;
+	size_t len = 0;
+	bool ok = false;
+
+	struct saved {
+		long long start, end, done;
+	};
+	std::vector<saved> saves;
+
+	if (readline(f, &line, &len) && !strcmp(line, url) &&
+		readline(f, &line, &len)) {
+
+		validator = String::fromUTF8(line);
+
+		saved sv;
+		ok = fscanf(f, "%lld\n", &size) == 1;
+		while (ok && fscanf(f, "%lld %lld %lld\n", &sv.start, &sv.end, &sv.done) == 3)
+			saves.push_back(sv);
+		ok = ok && !saves.empty();
+	}
+
+	// Without a validator no If-Range goes out, and a changed file would
+	// be mixed with the old part
+	if (validator.isEmpty())
+		ok = false;
+
+	free(line);
+	fclose(f);
+
+	// The part must still hold what the state says is done. A missing or
+	// truncated one would leave holes of zeros in the finished file.
+	struct stat st;
+	if (ok && fstat(fd, &st))
+		ok = false;
+	if (ok && size >= 0 && st.st_size != size)
+		ok = false;
+	for (const saved &sv: saves) {
+		if (ok && sv.start + sv.done > st.st_size)
+			ok = false;
+	}
+
+	if (!ok) {
+		size = -1;
+		validator = String();
+		return false;
+	}
+
+	for (const saved &sv: saves) {
+		addsegment(sv.start, sv.end, sv.done);
+		received += sv.done;
+	}
+
+	return true;
+}
+
+void download::savestate() {
+
+	if (!ranges || isData)
+		return;
+
+	const CString tmpname(String(String::fromUTF8(statename.data()) + ".tmp").utf8());
+	FILE *f = fopen(tmpname.data(), "w");
+	if (!f)
+		return;
+
+	fprintf(f, "%s\n%s\n%lld\n", url, validator.utf8().data(), size);
+	for (const segment *s: segments)
+		fprintf(f, "%lld %lld %lld\n", s->start, s->end, s->done);
+
+	if (fclose(f) == 0)
+		rename(tmpname.data(), statename.data());
+	else
+		unlink(tmpname.data());
 }
 
 bool download::isFailed() const {
@@ -160,3 +463,16 @@ void download::getStats(time_t *start, long long *size, long long *received) con
 	*size = this->size;
 	*received = this->received;
 }
+
+unsigned download::getSegments(long long *stats, const unsigned max) const {
+
+	const unsigned num = segments.size();
+	for (unsigned i = 0; i < num && i < max; i++) {
+		const segment * const s = segments[i];
+		stats[i * 3 + 0] = s->start;
+		stats[i * 3 + 1] = s->end >= 0 ? s->end - s->start + 1 : -1;
+		stats[i * 3 + 2] = s->done;
+	}
+
+	return num;
+}
@@ -21,31 +21,59 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <platform/PlatformExportMacros.h>
 #include <CurlDownload.h>
 #include <ResourceRequest.h>
+#include <wtf/text/CString.h>
 
-class download: public WebCore::CurlDownloadListener {
+#include <vector>
+
+// Downloads go to file.part first. When the server takes ranges, a large
+// file is split into segments, each fetched over its own connection and
+// written in place. The segments are saved to file.part.state, so
+// downloading the same url to the same file again resumes.
+class download {
 public:
 	download(const char *url, const char *file,
 			const WebCore::ResourceRequest *req = NULL);
-	virtual ~download();
+	~download();
 
 	void stop();
 
-	void didReceiveResponse() override;
-	void didReceiveDataOfLength(int size) override;
-	void didFinish() override;
-	void didFail() override;
-
 	void getStats(time_t *start, long long *size, long long *received) const;
+	// Offset, size, received triplets, returns the number of segments
+	unsigned getSegments(long long *stats, const unsigned max) const;
 	bool isFailed() const;
 	bool isFinished() const;
 
 	const char *url, *file;
 private:
-	WebCore::CurlDownload curl;
-	time_t time;
+	class segment;
+	friend class segment;
+
+	void addsegment(const long long start, const long long end,
+			const long long done);
+	void split(const long long total);
+	void segmentresponse(segment *);
+	void segmentdata(const int len);
+	void segmentdone();
+	void finish();
+	void fail();
+
+	bool loadstate();
+	void savestate();
+
+	std::vector<segment *> segments;
+	segment *probe; // the first request, until it's known if ranges work
+	WebCore::ResourceRequest req;
+	bool hasreq;
+	WTF::String validator; // ETag or Last-Modified, for If-Range
+	WTF::CString partname, statename;
+	int fd;
+
+	time_t time, lastsave;
 	long long size, received;
 	bool failed, finished;
 	bool isData;
+	bool ranges; // segments can resume
+	bool stale; // The server has a different file than the state
 };
 
 #endif
@@ -18,7 +18,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 #include "frameclient.h"
 #include "webviewpriv.h"
-#include "dirlisting.h"
 
 #include <AuthenticationChallenge.h>
 #include <Credential.h>
@@ -38,7 +37,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <FL/fl_ask.H>
 
 #include <sys/types.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace WebCore;
@@ -359,29 +357,7 @@ void FlFrameLoaderClient::dispatchDecidePolicyForNavigationAction(const Navigati
 	if (view->priv->loadStateChanged)
 		view->priv->loadStateChanged(view);
 
-	if (req.url().string().startsWith("file://")) {
-
-		const char *path = strdup(req.url().string().utf8().data() + 7);
-		struct stat st;
-		static bool byus = false;
-
-		if (stat(path, &st) == 0 && S_ISDIR(st.st_mode) && !byus) {
-			const char *list = gendirlisting(path);
-			policyfunc(PolicyIgnore);
-
-			byus = true;
-			view->loadString(list, "text/html", "UTF-8",
-						req.url().string().utf8().data());
-
-			byus = false;
-
-			free((char *) list);
-			free((char *) path);
-
-			return;
-		}
-		free((char *) path);
-	} else if (req.url().string().startsWith("about:") &&
+	if (req.url().string().startsWith("about:") &&
 		req.url().string() != "about:blank") {
 
 		static bool byus = false;
@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ApplicationCacheStorage.h>
 #include <CrossOriginPreflightResultCache.h>
+#include <CurlCacheManager.h>
+#include <FileURL.h>
 #include <FontCache.h>
 #include <GCController.h>
 #include <IconDatabase.h>
@@ -32,13 +34,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <PageCache.h>
 #include <PageGroup.h>
 #include <ResourceHandle.h>
+#include <ResourceHandleManager.h>
 #include <TextEncodingRegistry.h>
 #include "webkit.h"
+#include "dirlisting.h"
 
 #include "platformstrategy.h"
 
+#include <runtime/CodeCacheStorage.h>
 #include <runtime/InitializeThreading.h>
+#include <runtime/Options.h>
+#include <wtf/FastMalloc.h>
 #include <wtf/MainThread.h>
+#include <wtf/RunLoop.h>
 #include <wtf/spoofing.h>
 
 #include <cairo.h>
@@ -68,6 +76,8 @@ const char *(*spoofedLanguage)(const char *) = NULL;
 const char *wk_stream_exec = NULL;
 const char *wk_cookiepath = NULL;
 int wheelspeed = 100;
+unsigned downloadconnections = 4;
+unsigned frameinterval = 16600;
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000
 
@@ -94,6 +104,7 @@ void webkitInit() {
 
 	JSC::initializeThreading();
 	WTF::initializeMainThread();
+	RunLoop::initializeMainRunLoop();
 
 #if !LOG_DISABLED
 	WebCore::initializeLoggingChannelsIfNecessary();
@@ -102,6 +113,9 @@ void webkitInit() {
 	PlatformStrategiesFLTK::initialize();
 	atomicCanonicalTextEncodingName("UTF-8");
 
+	// file:// directories are loaded as this listing
+	setDirectoryListingFunction(gendirlisting);
+
 	Fl::lock();
 
 	// Make sure the runtime cairo version is new enough
@@ -150,6 +164,13 @@ void wk_set_wheel_speed(const int in) {
 	wheelspeed = in;
 }
 
+void wk_set_max_fps(const unsigned fps) {
+	if (!fps)
+		frameinterval = 0;
+	else
+		frameinterval = 1000 * 1000 / fps;
+}
+
 void wk_set_aboutpage_func(const char * (*func)(const char*)) {
 	aboutpagefunc = func;
 }
@@ -190,6 +211,31 @@ void wk_drop_caches() {
 
 	// Run GC
 	WebCore::gcController().garbageCollectNow();
+
+	wk_release_memory();
+}
+
+void wk_release_memory() {
+	WTF::releaseFastMallocFreeMemory();
+}
+
+static void convertmem(const WTF::FastMallocClassStatistics &from, wk_mem_class &to) {
+	to.committed = from.committedVMBytes;
+	to.free = from.freeListBytes;
+	to.pages = from.pageCount;
+	to.pages_used = from.pagesInUse;
+	to.lines = from.lineCount;
+	to.lines_used = from.linesInUse;
+}
+
+void wk_get_mem_stats(wk_mem_stats *out) {
+	const WTF::FastMallocDetailedStatistics detailed = WTF::fastMallocDetailedStatistics();
+
+	out->reserved = detailed.reservedVMBytes;
+	convertmem(detailed.small, out->small);
+	convertmem(detailed.medium, out->medium);
+	convertmem(detailed.large, out->large);
+	convertmem(detailed.xLarge, out->xlarge);
 }
 
 char *wk_urlencode(const char *in) {
@@ -231,10 +277,18 @@ void wk_set_new_download_func(void (*func)()) {
 	newdownloadfunc = func;
 }
 
+void wk_set_download_connections(const unsigned num) {
+	downloadconnections = num ? num : 1;
+}
+
 void wk_set_bgtab_func(void (*func)(const char*)) {
 	bgtabfunc = func;
 }
 
+void wk_set_ftl_jit(const bool enable) {
+	JSC::Options::useFTLJIT() = enable;
+}
+
 class dbclient: public IconDatabaseClient {
 public:
 	dbclient(void (*func)()): done(func) {}
@@ -351,10 +405,16 @@ void wk_exit() {
 
 void wk_set_cache_dir(const char *dir) {
 	WebCore::ApplicationCacheStorage::singleton().setCacheDirectory(dir);
+	WebCore::CurlCacheManager::getInstance().setCacheDirectory(String(dir) + "/http");
 }
 
 void wk_set_cache_max(const unsigned bytes) {
 	WebCore::ApplicationCacheStorage::singleton().setMaximumSize(bytes);
+	WebCore::CurlCacheManager::getInstance().setStorageSizeLimit(bytes);
+}
+
+void wk_set_js_cache_dir(const char *dir) {
+	JSC::CodeCacheStorage::setDirectory(dir ? String::fromUTF8(dir) : String());
 }
 
 void wk_set_tz_func(int (*func)()) {
@@ -382,6 +442,14 @@ void wk_set_cookie_path(const char *path) {
 	asprintf((char **) &wk_cookiepath, "%s/cookies.dat", path);
 }
 
+void wk_enable_network_thread() {
+	ResourceHandleManager::sharedInstance()->enableNetworkThread();
+}
+
+void wk_set_max_connections(const unsigned total, const unsigned perhost) {
+	ResourceHandleManager::sharedInstance()->setMaxConnections(total, perhost);
+}
+
 void wk_set_image_max(const unsigned size) {
 #if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
 	ImageSource::setMaxPixelsPerDecodedImage(size * size);
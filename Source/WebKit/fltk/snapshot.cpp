@@ -0,0 +1,159 @@
+/*
+WebkitFLTK
+Copyright (C) 2014 Lauri Kasanen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, version 3 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+#include "snapshot.h"
+
+#include <png.h>
+#include <stdint.h>
+#include <string.h>
+#include <wtf/Vector.h>
+
+// Cairo's premultiplied native endian ARGB to straight RGBA bytes
+static void unpremultiply(const unsigned char *src, unsigned char *dst,
+				const unsigned w) {
+
+	const uint32_t *in = (const uint32_t *) src;
+	for (unsigned i = 0; i < w; i++, dst += 4) {
+		const uint32_t px = in[i];
+		const unsigned a = px >> 24;
+		unsigned r = (px >> 16) & 0xff;
+		unsigned g = (px >> 8) & 0xff;
+		unsigned b = px & 0xff;
+
+		if (a && a != 255) {
+			r = (r * 255 + a / 2) / a;
+			g = (g * 255 + a / 2) / a;
+			b = (b * 255 + a / 2) / a;
+		}
+
+		dst[0] = r;
+		dst[1] = g;
+		dst[2] = b;
+		dst[3] = a;
+	}
+}
+
+class pngwriter: public snapshotwriter {
+public:
+	pngwriter(): png(NULL), info(NULL), w(0) {}
+
+	~pngwriter() {
+		if (png)
+			png_destroy_write_struct(&png, &info);
+	}
+
+	bool begin(FILE *out, const unsigned width, const unsigned height) override {
+		png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		if (!png)
+			return false;
+		info = png_create_info_struct(png);
+		if (!info)
+			return false;
+
+		w = width;
+		row.resize(w * 4);
+		return header(out, height);
+	}
+
+	bool rows(const unsigned char *data, const unsigned stride,
+			const unsigned num) override {
+		for (unsigned i = 0; i < num; i++) {
+			unpremultiply(data + i * stride, row.data(), w);
+			if (!writerow())
+				return false;
+		}
+		return true;
+	}
+
+	bool end() override {
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		png_write_end(png, NULL);
+		return true;
+	}
+
+private:
+	// libpng reports errors with longjmp, keep it away from anything
+	// with a destructor.
+	bool header(FILE *out, const unsigned height) {
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		png_init_io(png, out);
+		png_set_IHDR(png, info, w, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+				PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+				PNG_FILTER_TYPE_DEFAULT);
+		png_write_info(png, info);
+		return true;
+	}
+
+	bool writerow() {
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		png_write_row(png, row.data());
+		return true;
+	}
+
+	png_structp png;
+	png_infop info;
+	unsigned w;
+	Vector<unsigned char> row;
+};
+
+// Netpbm PAM: a short text header, then uncompressed RGBA rows
+class rawwriter: public snapshotwriter {
+public:
+	rawwriter(): out(NULL), w(0) {}
+
+	bool begin(FILE *file, const unsigned width, const unsigned height) override {
+		out = file;
+		w = width;
+		row.resize(w * 4);
+		return fprintf(out, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\n"
+				"TUPLTYPE RGB_ALPHA\nENDHDR\n", w, height) > 0;
+	}
+
+	bool rows(const unsigned char *data, const unsigned stride,
+			const unsigned num) override {
+		for (unsigned i = 0; i < num; i++) {
+			unpremultiply(data + i * stride, row.data(), w);
+			if (fwrite(row.data(), row.size(), 1, out) != 1)
+				return false;
+		}
+		return true;
+	}
+
+	bool end() override {
+		return fflush(out) == 0;
+	}
+
+private:
+	FILE *out;
+	unsigned w;
+	Vector<unsigned char> row;
+};
+
+snapshotwriter *newsnapshotwriter(const SnapshotFormat format) {
+	switch (format) {
+		case WK_SNAPSHOT_PNG:
+			return new pngwriter;
+		case WK_SNAPSHOT_RAW:
+			return new rawwriter;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,39 @@
+/*
+WebkitFLTK
+Copyright (C) 2014 Lauri Kasanen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, version 3 of the License.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef snapshot_h
+#define snapshot_h
+
+#include "webview.h"
+
+#include <stdio.h>
+
+// Streaming image encoder. It's fed the image top to bottom, in bands
+// of cairo ARGB32 rows, and writes them out as they come.
+class snapshotwriter {
+public:
+	virtual ~snapshotwriter() {}
+
+	virtual bool begin(FILE *out, const unsigned w, const unsigned h) = 0;
+	virtual bool rows(const unsigned char *data, const unsigned stride,
+				const unsigned num) = 0;
+	virtual bool end() = 0;
+};
+
+snapshotwriter *newsnapshotwriter(const SnapshotFormat format);
+
+#endif
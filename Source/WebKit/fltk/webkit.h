@@ -38,6 +38,13 @@ void webkitInit();
 // Content blocking. Return 0 for ok, 1 for block.
 void wk_set_urlblock_func(int (*func)(const char *));
 
+// Compiled content blocking, rules in the WebKit content blocker JSON format.
+// Compiling is slow: do it when the rules change, and load the file on
+// later starts. Both return 0 on success.
+int wk_compile_content_blocker(const char *json, const char *file);
+int wk_load_content_blocker(const char *file);
+void wk_unload_content_blockers();
+
 // Inline script blocking. Return 0 for ok, 1 for block.
 void wk_set_inlineblock_func(int (*func)(const char *, const char *));
 
@@ -56,6 +63,9 @@ void wk_set_ssl_err_func(void (*func)(webview *, const char *, const bool sub));
 // Scrolling speed
 void wk_set_wheel_speed(const int in);
 
+// Maximum frame rate, default 60. 0 means unthrottled, for benchmarking.
+void wk_set_max_fps(const unsigned fps);
+
 // about:// pages. Return a malloced array (will be freed), NULL if no such page.
 void wk_set_aboutpage_func(const char * (*func)(const char *));
 
@@ -68,15 +78,43 @@ void wk_set_download_refresh_func(void (*func)());
 // Callback for when a new download has been started
 void wk_set_new_download_func(void (*func)());
 
+// Connections per download, default 4. Large files from servers that
+// take ranges are fetched in that many parts, and resume where they were
+// left when downloaded again to the same file.
+void wk_set_download_connections(const unsigned num);
+
 // Page requests a popup to this address
 void wk_set_popup_func(webview *(*func)(const char*));
 
 // Please open this address in a background tab
 void wk_set_bgtab_func(void (*func)(const char*));
 
-// Drop RAM caches
+// The FTL, the top JS optimization tier. On by default when built with
+// FTL=1 against LLVM 3.6 and libllvmForJSC.so loads. Newer LLVMs are not
+// supported. Call after webkitInit, before loading.
+void wk_set_ftl_jit(const bool enable);
+
+// Drop RAM caches, and return the freed memory to the system
 void wk_drop_caches();
 
+// Return the allocator's free memory to the system now, without touching caches
+void wk_release_memory();
+
+// Allocator memory use by object size. Pages and lines only apply to small and medium.
+struct wk_mem_class {
+	size_t committed;
+	size_t free;
+	size_t pages, pages_used;
+	size_t lines, lines_used;
+};
+
+struct wk_mem_stats {
+	size_t reserved;
+	wk_mem_class small, medium, large, xlarge;
+};
+
+void wk_get_mem_stats(wk_mem_stats *out);
+
 // Set streaming program and args, default none
 void wk_set_streaming_prog(const char *);
 
@@ -94,13 +132,26 @@ void wk_set_favicon_dir(const char *dir, const std::vector<const char*> *preload
 			void (*done)() = NULL);
 Fl_RGB_Image *wk_get_favicon(const char *url, const unsigned targetsize = 16);
 
-// Cache
+// Disk cache for app caches and HTTP. Off until a dir is set, which
+// can only be done once.
+// The max applies to each separately.
 void wk_set_cache_dir(const char *dir);
 void wk_set_cache_max(const unsigned bytes);
 
+// Bytecode cache for large scripts, so they aren't compiled again on later
+// starts. Off until a dir is set. Not size-limited, clear it when convenient.
+void wk_set_js_cache_dir(const char *dir);
+
 // Per-site settings
 void wk_set_persite_settings_func(void (*func)(const char*));
 
+// Do network transfers in a separate thread. Call before loading anything.
+void wk_enable_network_thread();
+
+// Parallel connections, in total and per host. Defaults 128 and 6.
+// Pending requests start in priority order, CSS and scripts before images.
+void wk_set_max_connections(const unsigned total, const unsigned perhost);
+
 // Maximum image size. Default is 1024, meaning 1024^2 pixels. Larger ones get resized.
 void wk_set_image_max(const unsigned size);
 
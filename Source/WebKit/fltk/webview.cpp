@@ -18,11 +18,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 
 #include "kbd.h"
+#include "snapshot.h"
 #include "webview.h"
 #include "webviewpriv.h"
 
 #include <cairo-xlib.h>
 #include <fcntl.h>
+#include <math.h>
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
 #include <FL/Fl_File_Chooser.H>
@@ -59,11 +61,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <WebDatabaseProvider.h>
 #include <WebStorageNamespaceProvider.h>
 #include "visitedlinkstore.h"
+#include "contentblocker.h"
 
 using namespace WTF;
 using namespace WebCore;
 
 extern int wheelspeed;
+extern unsigned frameinterval;
 extern const char * (*downloaddirfunc)();
 extern void (*newdownloadfunc)();
 
@@ -86,7 +90,10 @@ webview::webview(int x, int y, int w, int h, bool noGui): Fl_Widget(x, y, w, h),
 	priv->siteChanging = NULL;
 	priv->error = NULL;
 	priv->resourceStateChanged = NULL;
+	priv->renderNeeded = NULL;
 	priv->quietdiags = false;
+	priv->framescheduled = false;
+	priv->renderscheduled = false;
 
 	Fl_Widget *wid = this;
 
@@ -104,7 +111,7 @@ webview::webview(int x, int y, int w, int h, bool noGui): Fl_Widget(x, y, w, h),
 	//clients.applicationCacheStorage
 	clients.databaseProvider = &WebDatabaseProvider::singleton();
 	clients.storageNamespaceProvider = WebStorageNamespaceProvider::create(String());
-	//clients.userContentController
+	clients.userContentController = usercontent();
 	clients.visitedLinkStore = &WebVisitedLinkStore::singleton();
 
 	clients.chromeClient = new FlChromeClient(this);
@@ -158,13 +165,55 @@ webview::webview(int x, int y, int w, int h, bool noGui): Fl_Widget(x, y, w, h),
 	priv->page->focusController().setActive(true);
 	priv->page->focusController().setFocusedFrame(&priv->page->mainFrame());
 
+	// Headless views have no window to be shown in
+	if (noGUI)
+		priv->page->setIsVisible(true);
+
 	// Cairo
 	resize();
 
 	clock_gettime(CLOCK_MONOTONIC, &priv->lastdraw);
 }
 
+static void frametimeout(void *ptr) {
+	webview * const view = (webview *) ptr;
+	privatewebview * const priv = view->priv;
+
+	priv->framescheduled = false;
+	if (!priv->dirty.isEmpty() || !priv->present.isEmpty())
+		view->damage(FL_DAMAGE_USER1);
+}
+
+static void rendertimeout(void *ptr) {
+	webview * const view = (webview *) ptr;
+	privatewebview * const priv = view->priv;
+
+	priv->renderscheduled = false;
+	if (priv->renderNeeded)
+		priv->renderNeeded(view);
+}
+
+void scheduleredraw(webview *view) {
+	privatewebview * const priv = view->priv;
+
+	if (!view->isNoGui()) {
+		view->damage(FL_DAMAGE_USER1);
+		return;
+	}
+
+	// Many invalidations come in a row, the host hears of them once
+	if (priv->renderNeeded && !priv->renderscheduled) {
+		Fl::add_timeout(0, rendertimeout, view);
+		priv->renderscheduled = true;
+	}
+}
+
 webview::~webview() {
+	if (priv->framescheduled)
+		Fl::remove_timeout(frametimeout, this);
+	if (priv->renderscheduled)
+		Fl::remove_timeout(rendertimeout, this);
+
 	// If any downloads exist, nuke them here.
 	const unsigned downs = priv->downloads.size();
 	for (unsigned i = 0; i < downs; i++) {
@@ -174,6 +223,11 @@ webview::~webview() {
 	if (priv->gc)
 		delete priv->gc;
 
+	if (!noGUI && priv->cairo) {
+		XFreeGC(fl_display, priv->pixgc);
+		XFreePixmap(fl_display, priv->cairopix);
+	}
+
 	delete priv->page;
 	delete priv;
 }
@@ -183,44 +237,82 @@ void webview::draw() {
 		return;
 	ASSERT(isMainThread());
 
-	if (noGUI) {
-		priv->clipx = 0;
-		priv->clipy = 0;
-		priv->clipw = w();
-		priv->cliph = h();
-//		drawWeb();
+	// Headless views paint in render()
+	if (noGUI)
 		return;
-	}
 
-	// Don't draw at over 60 fps. Save power and penguins.
+	// FL_DAMAGE_USER1 is our own invalidations, already in the dirty and
+	// present regions. Anything else is an expose or redraw, FLTK's clip
+	// says where.
+	int cx, cy, cw, ch;
+	fl_clip_box(x(), y(), w(), h(), cx, cy, cw, ch);
+	const bool expose = damage() & ~FL_DAMAGE_USER1;
+	if (expose && cw && ch)
+		priv->dirty.unite(IntRect(cx - x(), cy - y(), cw, ch));
+
+	if (priv->dirty.isEmpty() && priv->present.isEmpty())
+		return;
+
+	// Don't draw at over the frame rate. Save power and penguins.
+	// Too early damage is merged and painted on the next frame, the event
+	// loop is never blocked.
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
 
-	unsigned usecs = (now.tv_sec - priv->lastdraw.tv_sec) * 1000 * 1000;
-	usecs += (now.tv_nsec - priv->lastdraw.tv_nsec) / 1000;
-	if (usecs < 16600)
-		usleep(16600 - usecs);
+	if (frameinterval) {
+		unsigned usecs = (now.tv_sec - priv->lastdraw.tv_sec) * 1000 * 1000;
+		usecs += (now.tv_nsec - priv->lastdraw.tv_nsec) / 1000;
 
-	int cx, cy, cw, ch;
-	fl_clip_box(x(), y(), w(), h(), cx, cy, cw, ch);
-	if (!cw) return;
-	priv->clipx = cx - x();
-	priv->clipy = cy - y();
-	priv->clipw = cw;
-	priv->cliph = ch;
+		if (usecs < frameinterval) {
+			if (!priv->framescheduled) {
+				Fl::add_timeout((frameinterval - usecs) / 1000000.0,
+						frametimeout, this);
+				priv->framescheduled = true;
+			}
+
+			// Show the previous frame meanwhile, in case this was an expose.
+			if (expose && cw && ch)
+				XCopyArea(fl_display, priv->cairopix, fl_window, fl_gc,
+						cx - x(), cy - y(), cw, ch, cx, cy);
+			return;
+		}
+	}
 
 	drawWeb(); // for now here
 
-	const int tgtx = cx, tgty = cy;
+	// Present only what changed. The rects may lie outside an
+	// expose clip, so drop it for the copies.
+	const Vector<IntRect> rects = priv->present.rects();
+	priv->present = Region();
+
+	fl_push_no_clip();
+	const unsigned num = rects.size();
+	for (unsigned i = 0; i < num; i++) {
+		const IntRect &r = rects[i];
+		XCopyArea(fl_display, priv->cairopix, fl_window, fl_gc,
+				r.x(), r.y(), r.width(), r.height(),
+				r.x() + x(), r.y() + y());
+	}
+	fl_pop_clip();
 
-	// If the widget is offset somewhere, copy the right parts
-	cx -= x();
-	cy -= y();
+	priv->lastdraw = now;
+}
 
-	XCopyArea(fl_display, priv->cairopix, fl_window, fl_gc, cx, cy, cw, ch,
-			tgtx, tgty);
+// Painting many small rects separately costs more than painting their
+// bounds once, unless most of the bounds would be wasted.
+static bool paintbounds(const IntRect &bounds, const Vector<IntRect> &rects) {
+	const unsigned maxrects = 10;
+	const float maxwasted = 0.75f;
 
-	priv->lastdraw = now;
+	if (rects.size() <= 1 || rects.size() > maxrects)
+		return true;
+
+	unsigned area = 0;
+	for (const IntRect &r: rects)
+		area += r.width() * r.height();
+
+	const float boundsarea = bounds.width() * bounds.height();
+	return 1 - area / boundsarea <= maxwasted;
 }
 
 void webview::drawWeb() {
@@ -229,11 +321,25 @@ void webview::drawWeb() {
 	if (!f->contentRenderer() || !f->view() || !priv->cairo)
 		return;
 
+	// Layout may invalidate more, so take the region after it
 	f->view()->updateLayoutAndStyleIfNeededRecursive();
 
+	const IntRect bounds = priv->dirty.bounds();
+	Vector<IntRect> rects = priv->dirty.rects();
+	priv->dirty = Region();
+	if (paintbounds(bounds, rects)) {
+		rects.clear();
+		rects.append(bounds);
+	}
+
 	priv->gc->applyDeviceScaleFactor(f->page()->deviceScaleFactor());
-	f->view()->paint(priv->gc, IntRect(priv->clipx, priv->clipy,
-						priv->clipw, priv->cliph));
+	for (const IntRect &r: rects) {
+		priv->gc->save();
+		priv->gc->clip(r);
+		f->view()->paint(priv->gc, r);
+		priv->gc->restore();
+		priv->present.unite(r);
+	}
 	priv->page->inspectorController().drawHighlight(*priv->gc);
 }
 
@@ -299,6 +405,7 @@ void webview::resize() {
 	if (noGUI) {
 		cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w(), h());
 		priv->cairo = cairo_create(surf);
+		priv->cairosurf = surf;
 		cairo_surface_destroy(surf);
 
 		if (priv->gc)
@@ -308,6 +415,11 @@ void webview::resize() {
 		if (old)
 			priv->page->mainFrame().view()->resize(priv->w, priv->h);
 
+		// The new buffer is blank
+		priv->dirty = Region(IntRect(0, 0, w(), h()));
+		priv->present = Region();
+		scheduleredraw(this);
+
 		return;
 	}
 
@@ -315,6 +427,8 @@ void webview::resize() {
 		XFreePixmap(fl_display, priv->cairopix);
 	priv->cairopix = XCreatePixmap(fl_display, DefaultRootWindow(fl_display),
 					priv->w, priv->h, priv->depth);
+	if (!old)
+		priv->pixgc = XCreateGC(fl_display, priv->cairopix, 0, NULL);
 
 	cairo_surface_t *surf = cairo_xlib_surface_create(fl_display, priv->cairopix,
 								fl_visual->visual,
@@ -767,11 +881,14 @@ bool webview::downloadFailed(const unsigned i) const {
 
 void webview::downloadStats(const unsigned i, time_t *start, long long *size,
 			long long *received, const char **name,
-			const char **url) const {
+			const char **url, unsigned *segments,
+			long long *segstats, const unsigned maxsegs) const {
 	if (i >= priv->downloads.size())
 		return;
 
 	priv->downloads[i]->getStats(start, size, received);
+	if (segments)
+		*segments = priv->downloads[i]->getSegments(segstats, maxsegs);
 	*name = priv->downloads[i]->file;
 	*url = priv->downloads[i]->url;
 }
@@ -830,6 +947,10 @@ void webview::resourceStateChangedCB(void (*func)(unsigned long id, bool finishe
 	priv->resourceStateChanged = func;
 }
 
+void webview::renderNeededCB(void (*func)(webview *)) {
+	priv->renderNeeded = func;
+}
+
 void webview::back() {
 	if (!canBack())
 		return;
@@ -978,33 +1099,124 @@ unsigned webview::countFound(const char *what, bool caseSensitive) {
 	return priv->page->countFindMatches(String::fromUTF8(what), opts, UINT_MAX);
 }
 
-void webview::snapshot(const char *where) {
+bool webview::snapshot(const char *where, const SnapshotFormat format,
+			const float scale, const int x, const int y,
+			const int w, const int h) {
 
 	Frame * const f = &priv->page->mainFrame();
-	const unsigned cw = f->view()->contentsSize().width();
-	const unsigned ch = f->view()->contentsSize().height();
+	FrameView * const v = f->view();
+	if (!v || !f->contentRenderer() || !(scale > 0))
+		return false;
 
-	const unsigned oldw = w();
-	const unsigned oldh = h();
-	// Need to fool windowRect
-	size(cw, ch);
+	v->updateLayoutAndStyleIfNeededRecursive();
 
-	cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, cw, ch);
-	cairo_t *cc = cairo_create(surf);
-	cairo_surface_destroy(surf);
-	GraphicsContext *gc = new GraphicsContext(cc);
+	const IntSize contents = v->contentsSize();
+	IntRect region(x, y, w, h);
+	if (w <= 0)
+		region.setWidth(contents.width() - x);
+	if (h <= 0)
+		region.setHeight(contents.height() - y);
+	region.intersect(IntRect(IntPoint(), contents));
+	if (region.isEmpty())
+		return false;
 
-	f->view()->updateLayoutAndStyleIfNeededRecursive();
-	f->view()->paint(gc, IntRect(0, 0, cw, ch));
+	const unsigned outw = ceilf(region.width() * scale);
+	const unsigned outh = ceilf(region.height() * scale);
+	const unsigned bandh = std::min(256U, outh);
+
+	std::unique_ptr<snapshotwriter> writer(newsnapshotwriter(format));
+	FILE * const out = fopen(where, "w");
+	if (!writer || !out) {
+		if (out)
+			fclose(out);
+		return false;
+	}
+
+	cairo_surface_t * const surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+								outw, bandh);
+	cairo_t * const cc = cairo_create(surf);
+	GraphicsContext gc(cc);
+
+	bool ok = cairo_surface_status(surf) == CAIRO_STATUS_SUCCESS &&
+			writer->begin(out, outw, outh);
+
+	for (unsigned band = 0; ok && band < outh; band += bandh) {
+		const unsigned rows = std::min(bandh, outh - band);
+
+		// The page rows that scale to this band
+		const float top = region.y() + band / scale;
+		IntRect paintrect = enclosingIntRect(FloatRect(region.x(), top,
+						region.width(), rows / scale));
+		paintrect.intersect(region);
+
+		cairo_save(cc);
+		cairo_set_operator(cc, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(cc);
+		cairo_restore(cc);
+
+		gc.save();
+		gc.scale(FloatSize(scale, scale));
+		gc.translate(-region.x(), -top);
+		gc.clip(paintrect);
+		v->paintContentsForSnapshot(&gc, paintrect, FrameView::IncludeSelection,
+						FrameView::DocumentCoordinates);
+		gc.restore();
+
+		cairo_surface_flush(surf);
+		ok = writer->rows(cairo_image_surface_get_data(surf),
+					cairo_image_surface_get_stride(surf), rows);
+	}
+
+	if (ok)
+		ok = writer->end();
+	if (fclose(out))
+		ok = false;
 
-	const cairo_status_t ret = cairo_surface_write_to_png(surf, where);
 	cairo_destroy(cc);
-	delete gc;
-	size(oldw, oldh);
-	if (ret == CAIRO_STATUS_SUCCESS)
-		return;
+	cairo_surface_destroy(surf);
+
+	if (!ok)
+		unlink(where);
+	return ok;
+}
+
+unsigned webview::render(int *rects, const unsigned max) {
+
+	if (!noGUI || !priv->cairo)
+		return 0;
+	ASSERT(isMainThread());
+
+	drawWeb();
+	cairo_surface_flush(priv->cairosurf);
+
+	const IntRect bounds = priv->present.bounds();
+	Vector<IntRect> painted = priv->present.rects();
+	priv->present = Region();
+	if (painted.size() > max) {
+		painted.clear();
+		painted.append(bounds);
+	}
+
+	const unsigned num = painted.size();
+	for (unsigned i = 0; i < num && i < max; i++) {
+		const IntRect &r = painted[i];
+		rects[i * 4 + 0] = r.x();
+		rects[i * 4 + 1] = r.y();
+		rects[i * 4 + 2] = r.width();
+		rects[i * 4 + 3] = r.height();
+	}
+
+	return num;
+}
+
+const unsigned char *webview::pixels(unsigned *stride) const {
+
+	if (!noGUI || !priv->cairo)
+		return NULL;
 
-	fl_alert("%s", cairo_status_to_string(ret));
+	if (stride)
+		*stride = cairo_image_surface_get_stride(priv->cairosurf);
+	return cairo_image_surface_get_data(priv->cairosurf);
 }
 
 char *webview::focusedSource() const {
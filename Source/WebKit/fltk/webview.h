@@ -46,6 +46,11 @@ enum SettingChar {
 	WK_SETTING_USER_CSS,
 };
 
+enum SnapshotFormat {
+	WK_SNAPSHOT_PNG = 0,
+	WK_SNAPSHOT_RAW, // Netpbm PAM, uncompressed RGBA
+};
+
 class webview: public Fl_Widget {
 public:
 	webview(int x, int y, int w, int h, bool noGui = false);
@@ -75,7 +80,20 @@ public:
 	const char *title() const;
 	const char *url() const;
 
-	void snapshot(const char *);
+	// Save the page as an image. It's painted in bands, memory use doesn't
+	// grow with the page. The region is in page coordinates; a zero width
+	// or height extends it to the end of the page.
+	bool snapshot(const char *file, const SnapshotFormat format = WK_SNAPSHOT_PNG,
+			const float scale = 1, const int x = 0, const int y = 0,
+			const int w = 0, const int h = 0);
+
+	// Headless rendering, for views made with noGui. render() paints what
+	// changed since the last call, and stores the changed rects as x, y,
+	// w, h quads. Returns their number; if more than max changed, their
+	// bounds are stored instead. The buffer is premultiplied ARGB32 in
+	// native endian, valid until the next resize.
+	unsigned render(int *rects = NULL, const unsigned max = 0);
+	const unsigned char *pixels(unsigned *stride) const;
 
 	// Return the malloced source code of the focused frame
 	char *focusedSource() const;
@@ -88,9 +106,14 @@ public:
 	void removeDownload(const unsigned);
 	bool downloadFinished(const unsigned) const;
 	bool downloadFailed(const unsigned) const;
+	// Optionally also the parts of a multi-connection download: up to
+	// maxsegs offset, size, received triplets go to segstats, and
+	// *segments says how many parts there are.
 	void downloadStats(const unsigned, time_t *start, long long *size,
 				long long *received,
-				const char **name, const char **url) const;
+				const char **name, const char **url,
+				unsigned *segments = NULL, long long *segstats = NULL,
+				const unsigned maxsegs = 0) const;
 
 	privatewebview *priv;
 
@@ -139,6 +162,9 @@ public:
 	void siteChangingCB(void (*func)(webview *, const char *url));
 	void errorCB(void (*error)(webview *, const char *err));
 	void resourceStateChangedCB(void (*resourceStateChanged)(unsigned long id, bool finished));
+	// Headless views: something changed, call render() when convenient.
+	// Called from the event loop, never from inside WebKit.
+	void renderNeededCB(void (*func)(webview *));
 
 	// Bind a callback to element action. Call after loading has finished.
 	void bindEvent(const char *element, const char *type, const char *event,
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <EventHandler.h>
 #include <GraphicsContext.h>
 #include <Page.h>
+#include <Region.h>
 #include <wtf/text/CString.h>
 
 #include <time.h>
@@ -37,6 +38,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 typedef unsigned long Pixmap;
+typedef struct _XGC *GC;
 
 class privatewebview {
 public:
@@ -46,14 +48,20 @@ public:
 	cairo_surface_t *cairosurf;
 	WebCore::GraphicsContext *gc;
 	Pixmap cairopix;
+	GC pixgc;
 
 	Fl_Window *window;
 	unsigned depth;
 	unsigned w, h;
 
-	int clipx, clipy, clipw, cliph;
+	// Invalidated, not yet painted
+	WebCore::Region dirty;
+	// Up to date in the pixmap, to be copied to the window
+	WebCore::Region present;
 
 	struct timespec lastdraw;
+	bool framescheduled;
+	bool renderscheduled;
 
 	bool editing;
 
@@ -78,6 +86,10 @@ public:
 	void (*siteChanging)(webview *, const char *url);
 	void (*error)(webview *, const char *err);
 	void (*resourceStateChanged)(unsigned long id, bool finished);
+	void (*renderNeeded)(webview *);
 };
 
+// Repaint the view for new damage, or tell a headless one's host
+void scheduleredraw(webview *);
+
 #endif
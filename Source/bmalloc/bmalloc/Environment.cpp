@@ -87,8 +87,16 @@ static bool isASanEnabled()
 #endif
 }
 
+static bool isOptionEnabled(const char* name)
+{
+    char* variable = getenv(name);
+    return variable && strcmp(variable, "0");
+}
+
 Environment::Environment()
     : m_isBmallocEnabled(computeIsBmallocEnabled())
+    , m_isHugePagesEnabled(isOptionEnabled("BMALLOC_HUGE_PAGES"))
+    , m_isNUMAEnabled(isOptionEnabled("BMALLOC_NUMA"))
 {
 }
 
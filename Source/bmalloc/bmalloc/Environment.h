@@ -33,11 +33,15 @@ public:
     Environment();
     
     bool isBmallocEnabled() { return m_isBmallocEnabled; }
+    bool isHugePagesEnabled() { return m_isHugePagesEnabled; }
+    bool isNUMAEnabled() { return m_isNUMAEnabled; }
 
 private:
     bool computeIsBmallocEnabled();
 
     bool m_isBmallocEnabled;
+    bool m_isHugePagesEnabled;
+    bool m_isNUMAEnabled;
 };
 
 } // namespace bmalloc
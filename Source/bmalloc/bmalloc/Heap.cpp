@@ -31,6 +31,7 @@
 #include "Page.h"
 #include "PerProcess.h"
 #include "SmallChunk.h"
+#include "SuperChunk.h"
 #include <thread>
 
 namespace bmalloc {
@@ -38,6 +39,7 @@ namespace bmalloc {
 Heap::Heap(std::lock_guard<StaticMutex>&)
     : m_largeObjects(Owner::Heap)
     , m_isAllocatingPages(false)
+    , m_vmHeap(m_environment)
     , m_scavenger(*this, &Heap::concurrentScavenge)
 {
     initializeLineMetadata();
@@ -91,6 +93,7 @@ void Heap::scavenge(std::unique_lock<StaticMutex>& lock, std::chrono::millisecon
     scavengeSmallPages(lock, sleepDuration);
     scavengeMediumPages(lock, sleepDuration);
     scavengeLargeObjects(lock, sleepDuration);
+    m_vmHeap.deallocateFreeHugePages(lock);
 
     sleep(lock, sleepDuration);
 }
@@ -119,6 +122,63 @@ void Heap::scavengeLargeObjects(std::unique_lock<StaticMutex>& lock, std::chrono
     }
 }
 
+template<typename Chunk>
+static void addPageStatistics(std::lock_guard<StaticMutex>& lock, Chunk* chunk, ObjectTypeStatistics& statistics)
+{
+    for (auto* page = chunk->begin(); page != chunk->end(); ++page) {
+        size_t refCount = page->refCount(lock);
+        if (!refCount)
+            continue;
+
+        // Each line in use holds one reference on its page.
+        statistics.pagesInUse++;
+        statistics.lineCount += Chunk::Page::lineCount;
+        statistics.linesInUse += refCount;
+    }
+}
+
+HeapStatistics Heap::statistics(std::lock_guard<StaticMutex>& lock)
+{
+    HeapStatistics statistics;
+
+    for (SuperChunk* superChunk : m_vmHeap.superChunks()) {
+        statistics.reservedBytes += superChunkSize;
+
+        addPageStatistics(lock, superChunk->smallChunk(), statistics.small);
+        addPageStatistics(lock, superChunk->mediumChunk(), statistics.medium);
+
+        // Objects in the VM heap have had their physical pages returned.
+        LargeChunk* largeChunk = superChunk->largeChunk();
+        for (char* it = largeChunk->begin(); it != largeChunk->end();) {
+            LargeObject largeObject(LargeObject::DoNotValidate, it);
+            if (largeObject.owner() == Owner::Heap) {
+                statistics.large.committedBytes += largeObject.size();
+                if (largeObject.isFree())
+                    statistics.large.freeBytes += largeObject.size();
+            }
+            it = largeObject.end();
+        }
+    }
+
+    // Pages with no lines in use wait for the scavenger, still committed.
+    statistics.small.pageCount = statistics.small.pagesInUse + m_smallPages.size();
+    statistics.small.committedBytes = statistics.small.pageCount * vmPageSize;
+    statistics.small.freeBytes = m_smallPages.size() * vmPageSize
+        + (statistics.small.lineCount - statistics.small.linesInUse) * SmallPage::lineSize;
+
+    statistics.medium.pageCount = statistics.medium.pagesInUse + m_mediumPages.size();
+    statistics.medium.committedBytes = statistics.medium.pageCount * vmPageSize;
+    statistics.medium.freeBytes = m_mediumPages.size() * vmPageSize
+        + (statistics.medium.lineCount - statistics.medium.linesInUse) * MediumPage::lineSize;
+
+    for (auto& range : m_xLargeObjects) {
+        statistics.reservedBytes += range.size();
+        statistics.xLarge.committedBytes += range.size();
+    }
+
+    return statistics;
+}
+
 void Heap::refillSmallBumpRangeCache(std::lock_guard<StaticMutex>& lock, size_t sizeClass, BumpRangeCache& rangeCache)
 {
     BASSERT(!rangeCache.size());
@@ -193,6 +253,27 @@ void Heap::refillMediumBumpRangeCache(std::lock_guard<StaticMutex>& lock, size_t
     }
 }
 
+// With NUMA placement, free pages that were faulted in on another node are
+// left for the scavenger, and the caller gets a fresh page faulted in locally.
+template<typename Page>
+static Page* takeFreePage(Vector<Page*>& pages, bool isNUMAEnabled)
+{
+    static const size_t searchLimit = 16;
+
+    if (!pages.size())
+        return nullptr;
+    if (!isNUMAEnabled)
+        return pages.pop();
+
+    unsigned node = currentNUMANode();
+    size_t end = pages.size() > searchLimit ? pages.size() - searchLimit : 0;
+    for (size_t i = pages.size(); i-- > end;) {
+        if (pages[i]->node() == node)
+            return pages.pop(i);
+    }
+    return nullptr;
+}
+
 SmallPage* Heap::allocateSmallPage(std::lock_guard<StaticMutex>& lock, size_t sizeClass)
 {
     Vector<SmallPage*>& smallPagesWithFreeLines = m_smallPagesWithFreeLines[sizeClass];
@@ -204,11 +285,14 @@ SmallPage* Heap::allocateSmallPage(std::lock_guard<StaticMutex>& lock, size_t si
     }
 
     SmallPage* page = [this, sizeClass]() {
-        if (m_smallPages.size())
-            return m_smallPages.pop();
+        if (SmallPage* page = takeFreePage(m_smallPages, m_environment.isNUMAEnabled()))
+            return page;
 
         m_isAllocatingPages = true;
-        return m_vmHeap.allocateSmallPage();
+        SmallPage* page = m_vmHeap.allocateSmallPage();
+        if (m_environment.isNUMAEnabled())
+            page->setNode(currentNUMANode());
+        return page;
     }();
 
     page->setSizeClass(sizeClass);
@@ -226,11 +310,14 @@ MediumPage* Heap::allocateMediumPage(std::lock_guard<StaticMutex>& lock, size_t
     }
 
     MediumPage* page = [this, sizeClass]() {
-        if (m_mediumPages.size())
-            return m_mediumPages.pop();
+        if (MediumPage* page = takeFreePage(m_mediumPages, m_environment.isNUMAEnabled()))
+            return page;
 
         m_isAllocatingPages = true;
-        return m_vmHeap.allocateMediumPage();
+        MediumPage* page = m_vmHeap.allocateMediumPage();
+        if (m_environment.isNUMAEnabled())
+            page->setNode(currentNUMANode());
+        return page;
     }();
 
     page->setSizeClass(sizeClass);
@@ -28,6 +28,7 @@
 
 #include "BumpRange.h"
 #include "Environment.h"
+#include "HeapStatistics.h"
 #include "LineMetadata.h"
 #include "MediumChunk.h"
 #include "MediumLine.h"
@@ -71,6 +72,8 @@ public:
 
     void scavenge(std::unique_lock<StaticMutex>&, std::chrono::milliseconds sleepDuration);
 
+    HeapStatistics statistics(std::lock_guard<StaticMutex>&);
+
 private:
     ~Heap() = delete;
     
@@ -0,0 +1,48 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef HeapStatistics_h
+#define HeapStatistics_h
+
+#include <cstddef>
+
+namespace bmalloc {
+
+// With BMALLOC_HUGE_PAGES, scavenged small and medium pages stay resident
+// until their whole huge page is free, but are no longer counted here.
+struct ObjectTypeStatistics {
+    size_t committedBytes { 0 };
+    size_t freeBytes { 0 }; // Committed, but not handed out
+
+    // Small and medium only. Lines held by a thread's allocator count as in use.
+    size_t pageCount { 0 };
+    size_t pagesInUse { 0 };
+    size_t lineCount { 0 }; // In the pages in use
+    size_t linesInUse { 0 };
+};
+
+struct HeapStatistics {
+    size_t reservedBytes { 0 };
+
+    ObjectTypeStatistics small;
+    ObjectTypeStatistics medium;
+    ObjectTypeStatistics large;
+    ObjectTypeStatistics xLarge;
+};
+
+} // namespace bmalloc
+
+#endif // HeapStatistics_h
@@ -50,9 +50,14 @@ public:
     void ref(std::lock_guard<StaticMutex>&);
     bool deref(std::lock_guard<StaticMutex>&);
     unsigned refCount(std::lock_guard<StaticMutex>&) { return m_refCount; }
+    unsigned refCount(std::unique_lock<StaticMutex>&) { return m_refCount; }
     
     size_t sizeClass() { return m_sizeClass; }
     void setSizeClass(size_t sizeClass) { m_sizeClass = sizeClass; }
+
+    // The NUMA node the page was faulted in on, if NUMA placement is enabled
+    unsigned node() { return m_node; }
+    void setNode(unsigned node) { m_node = node; }
     
     Line* begin();
     Line* end();
@@ -60,6 +65,7 @@ public:
 private:
     unsigned char m_refCount;
     unsigned char m_sizeClass;
+    unsigned char m_node;
 };
 
 template<typename Traits>
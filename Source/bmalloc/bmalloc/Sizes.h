@@ -54,6 +54,7 @@ namespace Sizes {
     static const size_t vmPageMask = ~(vmPageSize - 1);
     
     static const size_t superChunkSize = 32 * MB;
+    static const size_t hugePageSize = 2 * MB;
 
     static const size_t smallMax = 256;
     static const size_t smallLineSize = 256;
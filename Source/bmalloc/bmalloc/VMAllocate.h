@@ -32,6 +32,7 @@
 #include "Syscall.h"
 #include <algorithm>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #if BOS(DARWIN)
@@ -148,6 +149,39 @@ inline void vmAllocatePhysicalPages(void* p, size_t vmSize)
 #endif
 }
 
+// Asks for transparent huge pages. Without kernel support this does nothing.
+inline void vmEnableHugePages(void* p, size_t vmSize)
+{
+    vmValidate(p, vmSize);
+#if defined(MADV_HUGEPAGE)
+    madvise(p, vmSize, MADV_HUGEPAGE);
+#endif
+}
+
+// Trims requests to whole huge pages, so no huge page gets split.
+inline void vmDeallocateHugePagesSloppy(void* p, size_t size)
+{
+    char* begin = roundUpToMultipleOf<hugePageSize>(static_cast<char*>(p));
+    char* end = roundDownToMultipleOf<hugePageSize>(static_cast<char*>(p) + size);
+
+    if (begin >= end)
+        return;
+
+    vmDeallocatePhysicalPages(begin, end - begin);
+}
+
+// The NUMA node of the CPU we run on, 0 where unknown.
+inline unsigned currentNUMANode()
+{
+#if defined(SYS_getcpu)
+    unsigned cpu;
+    unsigned node;
+    if (!syscall(SYS_getcpu, &cpu, &node, nullptr))
+        return node;
+#endif
+    return 0;
+}
+
 // Trims requests that are un-page-aligned.
 inline void vmDeallocatePhysicalPagesSloppy(void* p, size_t size)
 {
@@ -32,14 +32,21 @@
 
 namespace bmalloc {
 
-VMHeap::VMHeap()
+VMHeap::VMHeap(Environment& environment)
     : m_largeObjects(Owner::VMHeap)
+    , m_isHugePagesEnabled(environment.isHugePagesEnabled())
 {
 }
 
 void VMHeap::grow()
 {
     SuperChunk* superChunk = SuperChunk::create();
+    m_superChunks.push(superChunk);
+    if (m_isHugePagesEnabled) {
+        vmEnableHugePages(reinterpret_cast<char*>(superChunk->smallChunk()) + hugePageSize, smallChunkSize - hugePageSize);
+        vmEnableHugePages(reinterpret_cast<char*>(superChunk->mediumChunk()) + hugePageSize, mediumChunkSize - hugePageSize);
+        vmEnableHugePages(reinterpret_cast<char*>(superChunk->largeChunk()) + hugePageSize, largeChunkSize - hugePageSize);
+    }
 #if BOS(DARWIN)
     m_zone.addSuperChunk(superChunk);
 #endif
@@ -56,4 +63,38 @@ void VMHeap::grow()
     m_largeObjects.insert(LargeObject(LargeObject::init(largeChunk).begin()));
 }
 
+template<typename Chunk>
+static void deallocateFreeHugePages(std::unique_lock<StaticMutex>& lock, Chunk* chunk)
+{
+    char* chunkEnd = reinterpret_cast<char*>(chunk) + Chunk::chunkSize;
+    for (char* hugePage = reinterpret_cast<char*>(chunk) + hugePageSize; hugePage < chunkEnd; hugePage += hugePageSize) {
+        auto* page = Chunk::Page::get(Chunk::Line::get(hugePage));
+        auto* end = page + hugePageSize / vmPageSize;
+
+        bool isFree = true;
+        for (; page != end; ++page) {
+            if (page->refCount(lock)) {
+                isFree = false;
+                break;
+            }
+        }
+
+        // Free pages may be handed out again as soon as we're done, so the
+        // lock stays held. Nothing lives in them, so nothing gets lost.
+        if (isFree)
+            vmDeallocatePhysicalPages(hugePage, hugePageSize);
+    }
+}
+
+void VMHeap::deallocateFreeHugePages(std::unique_lock<StaticMutex>& lock)
+{
+    if (!m_isHugePagesEnabled)
+        return;
+
+    for (SuperChunk* superChunk : m_superChunks) {
+        bmalloc::deallocateFreeHugePages(lock, superChunk->smallChunk());
+        bmalloc::deallocateFreeHugePages(lock, superChunk->mediumChunk());
+    }
+}
+
 } // namespace bmalloc
@@ -27,6 +27,7 @@
 #define VMHeap_h
 
 #include "AsyncTask.h"
+#include "Environment.h"
 #include "FixedVector.h"
 #include "LargeChunk.h"
 #include "LargeObject.h"
@@ -41,6 +42,13 @@
 
 namespace bmalloc {
 
+// The first huge page of a chunk holds its metadata, which keeps it resident
+// anyway. It stays in small pages and is scavenged page by page.
+inline bool isHugePageBacked(void* p, size_t chunkSize)
+{
+    return (reinterpret_cast<uintptr_t>(p) & (chunkSize - 1)) >= hugePageSize;
+}
+
 class BeginTag;
 class EndTag;
 class Heap;
@@ -48,7 +56,7 @@ class SuperChunk;
 
 class VMHeap {
 public:
-    VMHeap();
+    VMHeap(Environment&);
 
     SmallPage* allocateSmallPage();
     MediumPage* allocateMediumPage();
@@ -59,13 +67,23 @@ public:
     void deallocateMediumPage(std::unique_lock<StaticMutex>&, MediumPage*);
     void deallocateLargeObject(std::unique_lock<StaticMutex>&, LargeObject&);
 
+    // With huge pages, small and medium pages are only returned once the whole
+    // huge page around them is free, so the scavenger calls this at the end.
+    void deallocateFreeHugePages(std::unique_lock<StaticMutex>&);
+
+    Vector<SuperChunk*>& superChunks() { return m_superChunks; }
+
 private:
     LargeObject allocateLargeObject(LargeObject&, size_t);
     void grow();
 
+    void deallocateLargePhysicalPages(char*, size_t);
+
     Vector<SmallPage*> m_smallPages;
     Vector<MediumPage*> m_mediumPages;
     SegregatedFreeList m_largeObjects;
+    Vector<SuperChunk*> m_superChunks;
+    bool m_isHugePagesEnabled;
 #if BOS(DARWIN)
     Zone m_zone;
 #endif
@@ -135,6 +153,11 @@ inline LargeObject VMHeap::allocateLargeObject(size_t alignment, size_t size, si
 
 inline void VMHeap::deallocateSmallPage(std::unique_lock<StaticMutex>& lock, SmallPage* page)
 {
+    if (m_isHugePagesEnabled && isHugePageBacked(page->begin()->begin(), smallChunkSize)) {
+        m_smallPages.push(page);
+        return;
+    }
+
     lock.unlock();
     vmDeallocatePhysicalPages(page->begin()->begin(), vmPageSize);
     lock.lock();
@@ -144,6 +167,11 @@ inline void VMHeap::deallocateSmallPage(std::unique_lock<StaticMutex>& lock, Sma
 
 inline void VMHeap::deallocateMediumPage(std::unique_lock<StaticMutex>& lock, MediumPage* page)
 {
+    if (m_isHugePagesEnabled && isHugePageBacked(page->begin()->begin(), mediumChunkSize)) {
+        m_mediumPages.push(page);
+        return;
+    }
+
     lock.unlock();
     vmDeallocatePhysicalPages(page->begin()->begin(), vmPageSize);
     lock.lock();
@@ -151,6 +179,23 @@ inline void VMHeap::deallocateMediumPage(std::unique_lock<StaticMutex>& lock, Me
     m_mediumPages.push(page);
 }
 
+inline void VMHeap::deallocateLargePhysicalPages(char* begin, size_t size)
+{
+    if (!m_isHugePagesEnabled) {
+        vmDeallocatePhysicalPagesSloppy(begin, size);
+        return;
+    }
+
+    char* end = begin + size;
+    char* hugePagesBegin = reinterpret_cast<char*>(LargeChunk::get(begin)) + hugePageSize;
+    if (begin < hugePagesBegin)
+        vmDeallocatePhysicalPagesSloppy(begin, std::min(end, hugePagesBegin) - begin);
+    if (end > hugePagesBegin) {
+        begin = std::max(begin, hugePagesBegin);
+        vmDeallocateHugePagesSloppy(begin, end - begin);
+    }
+}
+
 inline void VMHeap::deallocateLargeObject(std::unique_lock<StaticMutex>& lock, LargeObject& largeObject)
 {
     largeObject.setOwner(Owner::VMHeap);
@@ -164,7 +209,7 @@ inline void VMHeap::deallocateLargeObject(std::unique_lock<StaticMutex>& lock, L
     merged.setFree(false);
 
     lock.unlock();
-    vmDeallocatePhysicalPagesSloppy(merged.begin(), merged.size());
+    deallocateLargePhysicalPages(merged.begin(), merged.size());
     lock.lock();
 
     merged.setFree(true);
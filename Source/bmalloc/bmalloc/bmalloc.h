@@ -73,5 +73,12 @@ inline void scavenge()
     PerProcess<Heap>::get()->scavenge(lock, std::chrono::milliseconds(0));
 }
 
+// Memory held by the shared heap. Zero when bmalloc is disabled.
+inline HeapStatistics statistics()
+{
+    std::lock_guard<StaticMutex> lock(PerProcess<Heap>::mutex());
+    return PerProcess<Heap>::get()->statistics(lock);
+}
+
 } // namespace api
 } // namespace bmalloc
@@ -61,3 +61,98 @@ void mbscavenge()
 }
 
 } // extern "C"
+
+#if defined(MBMALLOC_TLB_BENCHMARK)
+
+// A pointer chase through small objects spread over far more memory than
+// the TLB covers. Build with "make tlbbench", then compare
+//     ./tlbbench
+//     BMALLOC_HUGE_PAGES=1 ./tlbbench
+// dTLB misses come from perf events, where the kernel allows them.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct Node {
+    Node* next;
+    char padding[56];
+};
+
+static int openTLBMissCounter()
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int main(int argc, char** argv)
+{
+    size_t nodeCount = argc > 1 ? strtoul(argv[1], nullptr, 0) : 4 * 1024 * 1024;
+    size_t steps = 64 * 1024 * 1024;
+
+    Node** nodes = static_cast<Node**>(mbmalloc(nodeCount * sizeof(Node*)));
+    for (size_t i = 0; i < nodeCount; ++i)
+        nodes[i] = static_cast<Node*>(mbmalloc(sizeof(Node)));
+
+    // Visit in random order, so each step likely lands on another page.
+    uint64_t random = 88172645463325252ull;
+    for (size_t i = nodeCount - 1; i; --i) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        std::swap(nodes[i], nodes[random % (i + 1)]);
+    }
+    for (size_t i = 0; i < nodeCount; ++i)
+        nodes[i]->next = nodes[(i + 1) % nodeCount];
+
+    int counter = openTLBMissCounter();
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Node* node = nodes[0];
+    for (size_t i = 0; i < steps; ++i)
+        node = node->next;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    long long misses = -1;
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &misses, sizeof(misses)) != sizeof(misses))
+            misses = -1;
+        close(counter);
+    }
+
+    printf("huge pages: %s, %zu MB in %zu objects\n", getenv("BMALLOC_HUGE_PAGES") ? "on" : "off",
+        nodeCount * sizeof(Node) >> 20, nodeCount);
+    printf("%zu steps: %lld ms", steps, static_cast<long long>(elapsed.count()));
+    if (misses >= 0)
+        printf(", %lld dTLB misses (%.3f per step)", misses, static_cast<double>(misses) / steps);
+    printf("\n");
+    if (!node) // Keeps the chase from being optimized out
+        return 1;
+
+    for (size_t i = 0; i < nodeCount; ++i)
+        mbfree(nodes[i], sizeof(Node));
+    mbfree(nodes, nodeCount * sizeof(Node*));
+    return 0;
+}
+
+#endif // defined(MBMALLOC_TLB_BENCHMARK)